@@ -1,7 +1,7 @@
 /***********************************************************
 * A single-header inlined math library, extended on demand *
 * no warranty implied | use at your own risk               *
-* author: Andreas Mantler (ands) | last change: 13.04.2018 *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
 *                                                          *
 * License:                                                 *
 * This software is in the public domain.                   *
@@ -10,6 +10,9 @@
 * and modify this file however you want.                   *
 ***********************************************************/
 
+#ifndef M_MATH_H
+#define M_MATH_H
+
 #if defined(_MSC_VER) && !defined(__cplusplus) // TODO: specific versions only?
 #define inline __inline
 #endif
@@ -30,6 +33,7 @@ static inline int      m_absi     (int    a          ) { return a < 0 ? -a : a;
 static inline float    m_minf     (float  a, float  b) { return a < b ? a : b; }
 static inline float    m_maxf     (float  a, float  b) { return a > b ? a : b; }
 static inline float    m_absf     (float  a          ) { return a < 0.0f ? -a : a; }
+static inline float    m_clampf   (float  a, float  lo, float hi) { return a < lo ? lo : (a > hi ? hi : a); }
 static inline float    m_pmodf    (float  a, float  b) { return (a < 0.0f ? 1.0f : 0.0f) + (float)fmod(a, b); } // positive mod
 
 typedef struct m_ivec2 { int x, y; } m_ivec2;
@@ -80,20 +84,38 @@ static inline m_bool  m_finite3   (m_vec3 a          ) { return m_finite(a.x) &&
 
 #define M_M_PI 3.14159265358979323846f
 
-static void m_mul44(float *out, float *a, float *b)
+typedef struct m_quat { float x, y, z, w; } m_quat;
+static inline m_quat  m_q         (float  x, float  y, float  z, float  w) { m_quat q = { x, y, z, w }; return q; }
+static inline m_quat  m_mulq      (m_quat a, m_quat b) { return m_q(a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y, a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x, a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w, a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z); }
+static inline float   m_lengthq   (m_quat a          ) { return sqrtf(a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w); }
+static inline m_quat  m_normalizeq(m_quat a          ) { float l = 1.0f / m_lengthq(a); return m_q(a.x * l, a.y * l, a.z * l, a.w * l); }
+static inline m_quat  m_axisAngleq(m_vec3 axis, float angle) // angle in degrees, like m_rotation44
+{
+	angle *= M_M_PI / 360.0f;
+	m_vec3 v = m_scale3(m_normalize3(axis), sinf(angle));
+	return m_q(v.x, v.y, v.z, cosf(angle));
+}
+static inline m_vec3  m_rotateq3  (m_quat q, m_vec3 v) // q * v * conjugate(q) for a unit q
+{
+	m_vec3 u = m_v3(q.x, q.y, q.z);
+	m_vec3 t = m_scale3(m_cross3(u, v), 2.0f);
+	return m_add3(m_add3(v, m_scale3(t, q.w)), m_cross3(u, t));
+}
+
+static inline void m_mul44(float *out, float *a, float *b)
 {
 	for (int y = 0; y < 4; y++)
 		for (int x = 0; x < 4; x++)
 			out[y * 4 + x] = a[x] * b[y * 4] + a[4 + x] * b[y * 4 + 1] + a[8 + x] * b[y * 4 + 2] + a[12 + x] * b[y * 4 + 3];
 }
-static void m_translation44(float *out, float x, float y, float z)
+static inline void m_translation44(float *out, float x, float y, float z)
 {
 	out[ 0] = 1.0f; out[ 1] = 0.0f; out[ 2] = 0.0f; out[ 3] = 0.0f;
 	out[ 4] = 0.0f; out[ 5] = 1.0f; out[ 6] = 0.0f; out[ 7] = 0.0f;
 	out[ 8] = 0.0f; out[ 9] = 0.0f; out[10] = 1.0f; out[11] = 0.0f;
 	out[12] = x;    out[13] = y;    out[14] = z;    out[15] = 1.0f;
 }
-static void m_rotation44(float *out, float angle, float x, float y, float z)
+static inline void m_rotation44(float *out, float angle, float x, float y, float z)
 {
 	angle *= M_M_PI / 180.0f;
 	float c = cosf(angle), s = sinf(angle), c2 = 1.0f - c;
@@ -102,21 +124,29 @@ static void m_rotation44(float *out, float angle, float x, float y, float z)
 	out[ 8] = x*z*c2 + y*s; out[ 9] = y*z*c2 - x*s; out[10] = z*z*c2 + c;   out[11] = 0.0f;
 	out[12] = 0.0f;         out[13] = 0.0f;         out[14] = 0.0f;         out[15] = 1.0f;
 }
-static void m_transform44(float *out, float *m, float *p)
+static inline void m_transform44(float *out, float *m, float *p)
 {
 	float d = 1.0f / (m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15]);
 	out[2] =     d * (m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14]);
 	out[1] =     d * (m[1] * p[0] + m[5] * p[1] + m[ 9] * p[2] + m[13]);
 	out[0] =     d * (m[0] * p[0] + m[4] * p[1] + m[ 8] * p[2] + m[12]);
 }
-static void m_transpose44(float *out, float *m)
+static inline void m_transpose44(float *out, float *m)
 {
 	out[ 0] = m[0]; out[ 1] = m[4]; out[ 2] = m[ 8]; out[ 3] = m[12];
 	out[ 4] = m[1]; out[ 5] = m[5]; out[ 6] = m[ 9]; out[ 7] = m[13];
 	out[ 8] = m[2]; out[ 9] = m[6]; out[10] = m[10]; out[11] = m[14];
 	out[12] = m[3]; out[13] = m[7]; out[14] = m[11]; out[15] = m[15];
 }
-static void m_perspective44(float *out, float fovy, float aspect, float zNear, float zFar)
+static inline void m_rotationq44(float *out, m_quat q) // unit quaternion
+{
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z, xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z, wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+	out[ 0] = 1.0f - 2.0f * (yy + zz); out[ 1] = 2.0f * (xy + wz);        out[ 2] = 2.0f * (xz - wy);        out[ 3] = 0.0f;
+	out[ 4] = 2.0f * (xy - wz);        out[ 5] = 1.0f - 2.0f * (xx + zz); out[ 6] = 2.0f * (yz + wx);        out[ 7] = 0.0f;
+	out[ 8] = 2.0f * (xz + wy);        out[ 9] = 2.0f * (yz - wx);        out[10] = 1.0f - 2.0f * (xx + yy); out[11] = 0.0f;
+	out[12] = 0.0f;                    out[13] = 0.0f;                    out[14] = 0.0f;                    out[15] = 1.0f;
+}
+static inline void m_perspective44(float *out, float fovy, float aspect, float zNear, float zFar)
 {
 	float f = 1.0f / tanf(fovy * M_M_PI / 360.0f);
 	float izFN = 1.0f / (zNear - zFar);
@@ -124,4 +154,6 @@ static void m_perspective44(float *out, float fovy, float aspect, float zNear, f
 	out[ 4] = 0.0f;       out[ 5] = f;    out[ 6] = 0.0f;                       out[ 7] = 0.0f;
 	out[ 8] = 0.0f;       out[ 9] = 0.0f; out[10] = (zFar + zNear) * izFN;      out[11] = -1.0f;
 	out[12] = 0.0f;       out[13] = 0.0f; out[14] = 2.0f * zFar * zNear * izFN; out[15] = 0.0f;
-}
\ No newline at end of file
+}
+
+#endif
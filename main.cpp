@@ -24,15 +24,14 @@ extern "C"
 	#include "yocto_obj.h"
 }
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
 #include "imgui.cpp"
 #include "imgui_draw.cpp"
 #include "imgui_impl_glfw_gl3.cpp"
 
 #include "m_math.h"
 #include "s_shader.h"
+#include "sh_project.h"
+#include "sh_order.h"
 
 typedef struct
 {
@@ -41,6 +40,7 @@ typedef struct
 		GLuint program;
 		GLint u_view;
 		GLint u_projection;
+		GLint u_rotation;
 		GLint u_cubemap;
 
 		GLuint vao, vbo, ibo;
@@ -56,11 +56,15 @@ typedef struct
 		GLint u_projection;
 		GLint u_coefficients;
 
-		GLuint vao, vbo;
-		int vertices;
+		GLuint vao, vbo, ibo;
+		int indices;
+		GLenum indexType;
 
-		m_vec3 coefficients[9];
+		m_vec3 coefficients[9]; // radiance as projected, before the environment rotation
 	} mesh;
+
+	m_quat rotation; // environment rotation, applied to the sky and the coefficients every frame
+	float factors[3]; // zonal harmonic kernel per band that turns radiance into shading
 } scene_t;
 
 static int initScene(scene_t *scene)
@@ -105,13 +109,14 @@ static int initScene(scene_t *scene)
 		"in vec3 a_position;\n"
 		"uniform mat4 u_view;\n"
 		"uniform mat4 u_projection;\n"
+		"uniform mat4 u_rotation;\n"
 		"out vec3 v_direction;\n"
 
 		"void main()\n"
 		"{\n"
 		"    vec4 position = u_projection * (u_view * vec4(a_position, 0.0));\n"
 		"    gl_Position = position.xyww;\n"
-		"    v_direction = a_position;\n"
+		"    v_direction = mat3(u_rotation) * a_position;\n"
 		"}\n";
 
 	const char *skyFP =
@@ -133,6 +138,7 @@ static int initScene(scene_t *scene)
 	}
 	scene->sky.u_view = glGetUniformLocation(scene->sky.program, "u_view");
 	scene->sky.u_projection = glGetUniformLocation(scene->sky.program, "u_projection");
+	scene->sky.u_rotation = glGetUniformLocation(scene->sky.program, "u_rotation");
 	scene->sky.u_cubemap = glGetUniformLocation(scene->sky.program, "u_cubemap");
 
 	//#define SKY_DIR "cubemaps/colors/"
@@ -141,76 +147,41 @@ static int initScene(scene_t *scene)
 	//#define SKY_DIR "cubemaps/powerlines/"
 	//#define SKY_DIR "cubemaps/bridge3/"
 	//#define SKY_DIR "cubemaps/coittower2/"
+	#define SKY_EXT ".jpg"
+	//#define SKY_EXT ".hdr" // radiance light probes, uploaded as GL_RGB16F
 
 	const char *skyTextureFiles[] = {
-		SKY_DIR "posx.jpg", SKY_DIR "negx.jpg",
-		SKY_DIR "posy.jpg", SKY_DIR "negy.jpg",
-		SKY_DIR "posz.jpg", SKY_DIR "negz.jpg"
-	};
-	const m_vec3 skyDir[] = {
-		m_v3(1.0f, 0.0f, 0.0f), m_v3(-1.0f, 0.0f, 0.0f),
-		m_v3(0.0f, 1.0f, 0.0f), m_v3(0.0f, -1.0f, 0.0f),
-		m_v3(0.0f, 0.0f, 1.0f), m_v3(0.0f, 0.0f, -1.0f)
-	};
-	const m_vec3 skyX[] = {
-		m_v3(0.0f, 0.0f, -1.0f), m_v3(0.0f, 0.0f, 1.0f),
-		m_v3(-1.0f, 0.0f, 0.0f), m_v3(1.0f, 0.0f, 0.0f),
-		m_v3(1.0f, 0.0f, 0.0f), m_v3(-1.0f, 0.0f, 0.0f)
-	};
-	const m_vec3 skyY[] = {
-		m_v3(0.0f, 1.0f, 0.0f), m_v3(0.0f, 1.0f, 0.0f),
-		m_v3(0.0f, 0.0f, -1.0f), m_v3(0.0f, 0.0f, 1.0f),
-		m_v3(0.0f, 1.0f, 0.0f), m_v3(0.0f, 1.0f, 0.0f)
+		SKY_DIR "posx" SKY_EXT, SKY_DIR "negx" SKY_EXT,
+		SKY_DIR "posy" SKY_EXT, SKY_DIR "negy" SKY_EXT,
+		SKY_DIR "posz" SKY_EXT, SKY_DIR "negz" SKY_EXT
 	};
 	glGenTextures(1, &scene->sky.texture);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, scene->sky.texture);
 
-	float weightSum = 0.0f;
+	// decode and project the faces on worker threads, only upload them here
+	sh_settings shSettings;
+	sh_settings_init(&shSettings);
+	shSettings.resolution = 128;
+	shSettings.weighting = SH_WEIGHT_EXACT;
+	shSettings.cacheFile = "cubemaps/sh_cache.bin"; // R reloads of unchanged faces skip the projection
+	bool skyHDR = sh_is_hdr_file(skyTextureFiles[0]) != 0;
+	void *skyFaces[6] = { 0 };
+	int skyW = 0, skyH = 0;
+	int loaded = skyHDR ?
+		sh_load_cubemap_rgbf(skyTextureFiles, &shSettings, (float**)skyFaces, &skyW, &skyH, scene->mesh.coefficients) :
+		sh_load_cubemap_rgb8(skyTextureFiles, &shSettings, (unsigned char**)skyFaces, &skyW, &skyH, scene->mesh.coefficients);
+	if (!loaded)
+	{
+		fprintf(stderr, "Error loading sky texture\n");
+		return 0;
+	}
+	sh_flush_cache(); // a new projection is kept for the next run right away
 	for (int i = 0; i < 6; i++)
 	{
-		int w, h, c;
-		unsigned char *stbidata = stbi_load(skyTextureFiles[i], &w, &h, &c, 3);
-		if (!stbidata)
-		{
-			fprintf(stderr, "Error loading sky texture\n");
-			return 0;
-		}
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, stbidata);
-
-		// also calculate SH coefficients:
-		int step = 16;
-		for (int y = 0; y < h; y += step)
-		{
-			unsigned char *p = stbidata + y * w * 3;
-			for (int x = 0; x < w; x += step)
-			{
-				m_vec3 n = m_add3(
-					m_add3(
-						m_scale3(skyX[i], 2.0f * (x / (w - 1.0f)) - 1.0f),
-						m_scale3(skyY[i], -2.0f * (y / (h - 1.0f)) + 1.0f)),
-					skyDir[i]); // texelDirection;
-				float l = m_length3(n);
-				float weight = 1.0f / (l * l * l); // fast approximation of texelSolidAngle
-				m_vec3 c_light = m_scale3(m_v3(p[0], p[1], p[2]), weight / 255.0f);
-				n = m_normalize3(n);
-				scene->mesh.coefficients[0] = m_add3(scene->mesh.coefficients[0], m_scale3(c_light, 0.282095f));
-				scene->mesh.coefficients[1] = m_add3(scene->mesh.coefficients[1], m_scale3(c_light, -0.488603f * n.y * 2.0f / 3.0f));
-				scene->mesh.coefficients[2] = m_add3(scene->mesh.coefficients[2], m_scale3(c_light, 0.488603f * n.z * 2.0f / 3.0f));
-				scene->mesh.coefficients[3] = m_add3(scene->mesh.coefficients[3], m_scale3(c_light, -0.488603f * n.x * 2.0f / 3.0f));
-				scene->mesh.coefficients[4] = m_add3(scene->mesh.coefficients[4], m_scale3(c_light, 1.092548f * n.x * n.y / 4.0f));
-				scene->mesh.coefficients[5] = m_add3(scene->mesh.coefficients[5], m_scale3(c_light, -1.092548f * n.y * n.z / 4.0f));
-				scene->mesh.coefficients[6] = m_add3(scene->mesh.coefficients[6], m_scale3(c_light, 0.315392f * (3.0f * n.z * n.z - 1.0f) / 4.0f));
-				scene->mesh.coefficients[7] = m_add3(scene->mesh.coefficients[7], m_scale3(c_light, -1.092548f * n.x * n.z / 4.0f));
-				scene->mesh.coefficients[8] = m_add3(scene->mesh.coefficients[8], m_scale3(c_light, 0.546274f * (n.x * n.x - n.y * n.y) / 4.0f));
-				p += 3 * step;
-				weightSum += weight;
-			}
-		}
-
-		free(stbidata);
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, skyHDR ? GL_RGB16F : GL_RGB, skyW, skyH, 0,
+			GL_RGB, skyHDR ? GL_FLOAT : GL_UNSIGNED_BYTE, skyFaces[i]);
+		free(skyFaces[i]);
 	}
-	for (int s = 0; s < 9; s++)
-		scene->mesh.coefficients[s] = m_scale3(scene->mesh.coefficients[s], 4.0f * M_M_PI / weightSum);
 
 	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -219,57 +190,76 @@ static int initScene(scene_t *scene)
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
-	// mesh
-	//yo_scene *yo = yo_load_obj("sphere.obj", true, false);
-	yo_scene *yo = yo_load_obj("dog.obj", true, false);
-	if (!yo || !yo->nshapes)
+	// mesh: mapped from the cache next to the obj file, made and cached on the first run
+	const char *meshFile = "dog.obj";
+	//const char *meshFile = "sphere.obj";
+	char meshCache[1024];
+	snprintf(meshCache, sizeof(meshCache), "%s.mesh", meshFile);
+	yo_mesh *mesh = yo_load_mesh(meshCache, meshFile);
+	if (!mesh)
 	{
-		fprintf(stderr, "Error loading obj file\n");
-		return 0;
-	}
-
-	scene->mesh.vertices = 0;
-	for (int i = 0; i < yo->nshapes; i++)
-		scene->mesh.vertices += yo->shapes[i].nelems * 3;
-
-	m_vec3 *positions = (m_vec3*)calloc(scene->mesh.vertices, sizeof(m_vec3));
-	m_vec3 *normals   = (m_vec3*)calloc(scene->mesh.vertices, sizeof(m_vec3));
-	size_t positionsSize = scene->mesh.vertices * sizeof(m_vec3);
-	size_t normalsSize   = scene->mesh.vertices * sizeof(m_vec3);
-
-	int n = 0;
-	for (int i = 0; i < yo->nshapes; i++)
-	{
-		yo_shape *shape = yo->shapes + i;
-		for (int j = 0; j < shape->nelems * 3; j++)
+		// parsed in chunks on the sh_project thread pool
+		yo_parallel_for parallelFor = [](int count, void (*task)(void *user, int index), void *user)
+		{
+			sh_parallel_for(count, 0, task, user);
+		};
+		yo_scene *yo = yo_load_obj_mt(meshFile, true, false, parallelFor);
+		if (!yo || !yo->nshapes)
 		{
-			positions[n + j] = *(m_vec3*)&shape->pos[shape->elem[j] * 3];
-			normals[n + j] = *(m_vec3*)&shape->norm[shape->elem[j] * 3];
+			fprintf(stderr, "Error loading obj file\n");
+			return 0;
 		}
-		n += shape->nelems * 3;
+		mesh = yo_make_mesh(yo);
+		yo_free_scene(yo);
+
+		// triangle and vertex order for the vertex cache and less overdraw, paid once and kept in the cache
+		int transforms = yo_mesh_transforms(mesh, 32);
+		yo_optimize_mesh(mesh, 32, true, parallelFor);
+		int optimized = yo_mesh_transforms(mesh, 32);
+		printf("mesh optimization (32 entry FIFO): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+			(float)transforms / mesh->ntriangles, (float)optimized / mesh->ntriangles,
+			(float)transforms / mesh->nverts, (float)optimized / mesh->nverts);
+		if (!yo_save_mesh(meshCache, mesh, meshFile))
+			fprintf(stderr, "Could not write mesh cache %s\n", meshCache);
 	}
-	yo_free_scene(yo);
-
-	// upload geometry to opengl
+	scene->mesh.indices = mesh->ntriangles * 3;
+	scene->mesh.indexType = mesh->index_size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	size_t positionsSize = mesh->nverts * sizeof(m_vec3);
+	size_t indicesSize = (size_t)scene->mesh.indices * mesh->index_size;
+
+	// indexed vs. one vertex per triangle corner: buffer sizes and vertex shader runs (through a typical 32 entry FIFO cache)
+	printf("mesh: %d triangles, %d vertices\n", mesh->ntriangles, mesh->nverts);
+	printf("  glDrawArrays:   %9zu VBO bytes, %8d vertex shader invocations\n",
+		(size_t)scene->mesh.indices * 2 * sizeof(m_vec3), yo_mesh_transforms(mesh, 0));
+	printf("  glDrawElements: %9zu VBO + IBO bytes, %8d vertex shader invocations (%d bit indices)\n",
+		mesh->size + indicesSize, yo_mesh_transforms(mesh, 32), mesh->index_size * 8);
+
+	// upload geometry to opengl: positions followed by normals, as laid out in the mesh (cache)
 	glGenVertexArrays(1, &scene->mesh.vao);
 	glBindVertexArray(scene->mesh.vao);
 
 	glGenBuffers(1, &scene->mesh.vbo);
 	glBindBuffer(GL_ARRAY_BUFFER, scene->mesh.vbo);
-	glBufferData(GL_ARRAY_BUFFER, positionsSize + normalsSize, NULL, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, mesh->size, NULL, GL_STATIC_DRAW);
 	unsigned char *buffer = (unsigned char*)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
 	assert(buffer);
-	memcpy(buffer, positions, positionsSize);
-	memcpy(buffer + positionsSize, normals, normalsSize);
+	memcpy(buffer, mesh->pos, mesh->size);
 	glUnmapBuffer(GL_ARRAY_BUFFER);
 
+	glGenBuffers(1, &scene->mesh.ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, scene->mesh.ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesSize, NULL, GL_STATIC_DRAW);
+	buffer = (unsigned char*)glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
+	assert(buffer);
+	memcpy(buffer, mesh->indices, indicesSize);
+	glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 	glEnableVertexAttribArray(1);
 	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)positionsSize);
 
-	free(positions);
-	free(normals);
+	yo_free_mesh(mesh);
 
 	const char *attribs[] =
 	{
@@ -291,30 +281,23 @@ static int initScene(scene_t *scene)
 		"    v_normal = a_normal;\n"
 		"}\n";
 
-	const char *fp =
+	char shEvaluate[4096];
+	sh_order<2>::glsl(shEvaluate, sizeof(shEvaluate), "shEvaluate", "u_coefficients");
+
+	char fp[8192];
+	snprintf(fp, sizeof(fp),
 		"#version 150 core\n"
 		"in vec3 v_normal;\n"
-		"uniform vec3 u_coefficients[9];\n"
+		"uniform vec3 u_coefficients[%d];\n"
 		"out vec4 o_color;\n"
 
+		"%s"
+
 		"void main()\n"
 		"{\n"
 		"    vec3 n = normalize(v_normal);\n"
-		"    vec3 SHLightResult[9];\n"
-		"    SHLightResult[0] = 0.282095f * u_coefficients[0];\n"
-		"    SHLightResult[1] = -0.488603f * n.y * u_coefficients[1];\n"
-		"    SHLightResult[2] = 0.488603f * n.z * u_coefficients[2];\n"
-		"    SHLightResult[3] = -0.488603f * n.x * u_coefficients[3];\n"
-		"    SHLightResult[4] = 1.092548f * n.x * n.y * u_coefficients[4];\n"
-		"    SHLightResult[5] = -1.092548f * n.y * n.z * u_coefficients[5];\n"
-		"    SHLightResult[6] = 0.315392f * (3.0f * n.z * n.z - 1.0f) * u_coefficients[6];\n"
-		"    SHLightResult[7] = -1.092548f * n.x * n.z * u_coefficients[7];\n"
-		"    SHLightResult[8] = 0.546274f * (n.x * n.x - n.y * n.y) * u_coefficients[8];\n"
-		"    vec3 result = vec3(0.0);\n"
-		"    for (int i = 0; i < 9; ++i)\n"
-		"        result += SHLightResult[i];\n"
-		"    o_color = vec4(result, 1.0);\n"
-		"}\n";
+		"    o_color = vec4(shEvaluate(n), 1.0);\n"
+		"}\n", sh_order<2>::count, shEvaluate);
 
 	scene->mesh.program = s_loadProgram(vp, fp, attribs, 2);
 	if (!scene->mesh.program)
@@ -336,19 +319,31 @@ static void drawScene(scene_t *scene, float *view, float *projection)
 	glDepthFunc(GL_LEQUAL);
 	//glDisable(GL_CULL_FACE);
 
+	// rotating the coefficients is a few 3x3 and 5x5 matrix products, no reprojection
+	sh_rotation rotation;
+	sh_rotation_init(&rotation, scene->rotation);
+	m_vec3 coefficients[9];
+	sh_rotate(&rotation, scene->mesh.coefficients, coefficients, 1);
+	sh_convolve(coefficients, scene->factors, 1);
+
+	// the sky looks up the unrotated cubemap
+	float inverseRotation[16];
+	m_rotationq44(inverseRotation, m_q(-scene->rotation.x, -scene->rotation.y, -scene->rotation.z, scene->rotation.w));
+
 	// mesh
 	glUseProgram(scene->mesh.program);
 	glUniformMatrix4fv(scene->mesh.u_projection, 1, GL_FALSE, projection);
 	glUniformMatrix4fv(scene->mesh.u_view, 1, GL_FALSE, view);
-	glUniform3fv(scene->mesh.u_coefficients, 9, &scene->mesh.coefficients[0].x);
+	glUniform3fv(scene->mesh.u_coefficients, 9, &coefficients[0].x);
 	glBindVertexArray(scene->mesh.vao);
-	glDrawArrays(GL_TRIANGLES, 0, scene->mesh.vertices);
+	glDrawElements(GL_TRIANGLES, scene->mesh.indices, scene->mesh.indexType, 0);
 
 	// sky
 	glDepthMask(GL_FALSE);
 	glUseProgram(scene->sky.program);
 	glUniformMatrix4fv(scene->sky.u_projection, 1, GL_FALSE, projection);
 	glUniformMatrix4fv(scene->sky.u_view, 1, GL_FALSE, view);
+	glUniformMatrix4fv(scene->sky.u_rotation, 1, GL_FALSE, inverseRotation);
 	glUniform1i(scene->sky.u_cubemap, 0);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, scene->sky.texture);
 	glBindVertexArray(scene->sky.vao);
@@ -369,6 +364,7 @@ static void destroyScene(scene_t *scene)
 	glDeleteProgram(scene->mesh.program);
 	glDeleteVertexArrays(1, &scene->mesh.vao);
 	glDeleteBuffers(1, &scene->mesh.vbo);
+	glDeleteBuffers(1, &scene->mesh.ibo);
 }
 
 static void fpsCameraViewMatrix(GLFWwindow *window, float *view, bool ignoreInput)
@@ -481,6 +477,26 @@ int main(int argc, char* argv[])
 			ImGui::ColorEdit3(name, &remapped.x);
 			scene.mesh.coefficients[i] = m_sub3(m_scale3(remapped, 2.0f), m_v3(1.0f, 1.0f, 1.0f));
 		}
+		static float skyYaw = 0.0f, skyPitch = 0.0f, skySpin = 0.0f;
+		ImGui::SliderFloat("sky yaw", &skyYaw, -180.0f, 180.0f);
+		ImGui::SliderFloat("sky pitch", &skyPitch, -90.0f, 90.0f);
+		ImGui::SliderFloat("sky spin (deg/s)", &skySpin, -90.0f, 90.0f);
+		skyYaw += skySpin * ImGui::GetIO().DeltaTime;
+		if (skyYaw > 180.0f) skyYaw -= 360.0f;
+		if (skyYaw < -180.0f) skyYaw += 360.0f;
+		scene.rotation = m_mulq(m_axisAngleq(m_v3(0.0f, 1.0f, 0.0f), skyYaw), m_axisAngleq(m_v3(1.0f, 0.0f, 0.0f), skyPitch));
+
+		// the projection stays radiance, switching the kernel is free
+		static int kernel = 0;
+		static float phongExponent = 8.0f, gaussianWidth = 0.5f;
+		ImGui::Combo("kernel", &kernel, "lambert\0phong\0gaussian\0");
+		if (kernel == 1)
+			ImGui::SliderFloat("exponent", &phongExponent, 1.0f, 64.0f);
+		if (kernel == 2)
+			ImGui::SliderFloat("width", &gaussianWidth, 0.0f, 2.0f);
+		if (kernel == 0) sh_lambert_factors(3, scene.factors);
+		if (kernel == 1) sh_phong_factors(3, phongExponent, scene.factors);
+		if (kernel == 2) sh_gaussian_factors(3, gaussianWidth, scene.factors);
 		ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 		ImGui::End();
 
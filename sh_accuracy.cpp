@@ -0,0 +1,305 @@
+/***********************************************************
+* Accuracy vs. cost of the projection modes against a      *
+* double precision ground truth                            *
+* usage: shaccuracy [-csv <file>] [cubemap dir...]         *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+#include "stb_image.h"
+#include "sh_project.h"
+#include "sh_kernel.h"
+#include "sh_pool.h"
+
+static const char *defaultSets[] =
+{
+	"cubemaps/bridge3/",
+	"cubemaps/coittower2/",
+	"cubemaps/colors/",
+	"cubemaps/powerlines/",
+	"cubemaps/room/",
+	"cubemaps/tantolunden2/"
+};
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// solid angle of the face plane rectangle [0, x] x [0, y] at distance 1
+static double areaElement(double x, double y)
+{
+	return atan2(x * y, sqrt(x * x + y * y + 1.0));
+}
+
+// the reference integrates every texel as 2 x 2 sub texels with their exact
+// solid angles in double precision, without normalizing the weight sum.
+// one row of sums per texel row so the rows can be spread over the threads.
+typedef struct reference_t
+{
+	const unsigned char **faces;
+	int w, h;
+	double *rows; // [SH_FACES * h][SH_COEFFICIENTS * 3]
+} reference_t;
+
+static void referenceRow(void *user, int index)
+{
+	reference_t *r = (reference_t*)user;
+	int face = index / r->h, y = index % r->h;
+	const unsigned char *p = r->faces[face] + (size_t)y * r->w * 3;
+	const m_vec3 X = sh__skyX[face], Y = sh__skyY[face], D = sh__skyDir[face];
+	const double pi = 3.14159265358979323846;
+	const double k0 = 0.5 * sqrt(1.0 / pi), k1 = 0.5 * sqrt(3.0 / pi);
+	const double k2a = 0.5 * sqrt(15.0 / pi), k2b = 0.25 * sqrt(5.0 / pi), k2c = 0.25 * sqrt(15.0 / pi);
+	double *sum = r->rows + (size_t)index * SH_COEFFICIENTS * 3;
+	memset(sum, 0, SH_COEFFICIENTS * 3 * sizeof(double));
+	for (int x = 0; x < r->w; x++, p += 3)
+	{
+		for (int s = 0; s < 4; s++)
+		{
+			// sub texel [u0, u1] x [v0, v1], v grows upwards
+			double u0 = 2.0 * (x + 0.5 * (s & 1)) / r->w - 1.0, u1 = u0 + 1.0 / r->w;
+			double v1 = 1.0 - 2.0 * (y + 0.5 * (s >> 1)) / r->h, v0 = v1 - 1.0 / r->h;
+			double weight = areaElement(u1, v1) - areaElement(u0, v1) - areaElement(u1, v0) + areaElement(u0, v0);
+			double u = 0.5 * (u0 + u1), v = 0.5 * (v0 + v1);
+			double dx = X.x * u + Y.x * v + D.x, dy = X.y * u + Y.y * v + D.y, dz = X.z * u + Y.z * v + D.z;
+			double il = 1.0 / sqrt(dx * dx + dy * dy + dz * dz);
+			dx *= il; dy *= il; dz *= il;
+			double basis[SH_COEFFICIENTS] = {
+				k0, -k1 * dy, k1 * dz, -k1 * dx,
+				k2a * dx * dy, -k2a * dy * dz, k2b * (3.0 * dz * dz - 1.0), -k2a * dx * dz, k2c * (dx * dx - dy * dy)
+			};
+			for (int c = 0; c < 3; c++)
+			{
+				double light = weight * p[c] / 255.0;
+				for (int i = 0; i < SH_COEFFICIENTS; i++)
+					sum[i * 3 + c] += basis[i] * light;
+			}
+		}
+	}
+}
+
+static int projectReference(const unsigned char **faces, int w, int h, double *coefficients)
+{
+	reference_t r;
+	r.faces = faces;
+	r.w = w;
+	r.h = h;
+	r.rows = (double*)malloc((size_t)SH_FACES * h * SH_COEFFICIENTS * 3 * sizeof(double));
+	if (!r.rows)
+		return 0;
+	sh_parallel_for(SH_FACES * h, 0, referenceRow, &r);
+	memset(coefficients, 0, SH_COEFFICIENTS * 3 * sizeof(double));
+	for (int j = 0; j < SH_FACES * h; j++)
+		for (int i = 0; i < SH_COEFFICIENTS * 3; i++)
+			coefficients[i] += r.rows[(size_t)j * SH_COEFFICIENTS * 3 + i];
+	free(r.rows);
+	return 1;
+}
+
+typedef struct config_t
+{
+	const char *name;  // "step", "resolution" or "qmc"
+	sh_settings settings;
+	int samples;       // qmc directions
+} config_t;
+
+// best of a few single threaded runs, in nanoseconds per cubemap
+static double timeConfig(const unsigned char **faces, int w, int h, const config_t *mode, m_vec3 *coefficients)
+{
+	double best = 1e30;
+	double total = 0.0;
+	for (int run = 0; run < 20 && (run < 3 || total < 0.5); run++)
+	{
+		double start = now();
+		if (!strcmp(mode->name, "qmc"))
+		{
+			m_vec3 error[SH_COEFFICIENTS];
+			sh_project_cubemap_qmc_rgb8(faces, w, h, mode->samples, 0.0, coefficients, error);
+		}
+		else
+			sh_project_cubemap_rgb8(faces, w, h, &mode->settings, coefficients);
+		double t = now() - start;
+		total += t;
+		best = t < best ? t : best;
+	}
+	return best * 1e9;
+}
+
+static double rmsError(const m_vec3 *coefficients, const double *reference)
+{
+	double e = 0.0;
+	for (int i = 0; i < SH_COEFFICIENTS; i++)
+	{
+		double d[3] = { coefficients[i].x - reference[i * 3 + 0], coefficients[i].y - reference[i * 3 + 1], coefficients[i].z - reference[i * 3 + 2] };
+		e += d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+	}
+	return sqrt(e / (SH_COEFFICIENTS * 3));
+}
+
+static int addConfigs(config_t *modes, int w)
+{
+	static const int steps[] = { 1, 2, 4, 8, 16, 32 };
+	static const int resolutions[] = { 256, 128, 64, 32, 16 };
+	static const int samples[] = { 1024, 4096, 16384, 65536 };
+	static const sh_kernel kernels[] = { SH_KERNEL_SCALAR, SH_KERNEL_SSE2, SH_KERNEL_AVX2 };
+	int count = 0;
+	for (int k = 0; k < (int)(sizeof(kernels) / sizeof(kernels[0])); k++)
+	{
+		if (!sh_kernel_supported(kernels[k]))
+			continue;
+		for (int s = 0; s < (int)(sizeof(steps) / sizeof(steps[0])); s++)
+		{
+			for (int exact = 0; exact < 2 && steps[s] < w; exact++)
+			{
+				config_t *m = &modes[count++];
+				m->name = "step";
+				sh_settings_init(&m->settings);
+				m->settings.threads = 1;
+				m->settings.kernel = kernels[k];
+				m->settings.step = steps[s];
+				m->settings.weighting = exact ? SH_WEIGHT_EXACT : SH_WEIGHT_APPROX;
+				m->samples = 0;
+			}
+		}
+	}
+	for (int r = 0; r < (int)(sizeof(resolutions) / sizeof(resolutions[0])); r++)
+	{
+		if (resolutions[r] >= w)
+			continue;
+		config_t *m = &modes[count++];
+		m->name = "resolution";
+		sh_settings_init(&m->settings);
+		m->settings.threads = 1;
+		m->settings.resolution = resolutions[r];
+		m->settings.weighting = SH_WEIGHT_EXACT;
+		m->samples = 0;
+	}
+	for (int s = 0; s < (int)(sizeof(samples) / sizeof(samples[0])); s++)
+	{
+		config_t *m = &modes[count++];
+		m->name = "qmc";
+		sh_settings_init(&m->settings);
+		m->settings.threads = 1;
+		m->samples = samples[s];
+	}
+	return count;
+}
+
+static void usage()
+{
+	printf("usage: shaccuracy [-csv <file>] [cubemap dir...]\n"
+		"projects every set with every step, weighting, kernel, filtered resolution and qmc\n"
+		"sample count on one thread and compares the coefficients against a double precision\n"
+		"projection of every texel with exact solid angles (defaults to the sets in cubemaps/)\n"
+		"  -csv <file>  also write the rows as CSV (- for stdout instead of the table)\n");
+}
+
+int main(int argc, char *argv[])
+{
+	const char *csvFile = 0;
+	const char **sets = defaultSets;
+	int setCount = (int)(sizeof(defaultSets) / sizeof(defaultSets[0]));
+	int first = 1;
+	if (argc > 2 && !strcmp(argv[1], "-csv"))
+	{
+		csvFile = argv[2];
+		first = 3;
+	}
+	if (first < argc && argv[first][0] == '-' && argv[first][1])
+	{
+		usage();
+		return argv[first][1] == 'h' ? 0 : 1;
+	}
+	if (first < argc)
+	{
+		sets = (const char**)argv + first;
+		setCount = argc - first;
+	}
+
+	FILE *csv = 0;
+	if (csvFile)
+	{
+		csv = strcmp(csvFile, "-") ? fopen(csvFile, "w") : stdout;
+		if (!csv)
+		{
+			fprintf(stderr, "Error writing %s\n", csvFile);
+			return 1;
+		}
+		fprintf(csv, "set,size,mode,kernel,weighting,step,resolution,samples,ns_per_probe,rms_error,relative_rms_error\n");
+	}
+	int table = csv != stdout;
+	if (table)
+		printf("%-24s %5s %-10s %-6s %-6s %4s %5s %10s %12s %10s %10s\n",
+			"set", "size", "mode", "kernel", "weight", "step", "res", "samples", "ns/probe", "rms error", "relative");
+
+	int result = 0;
+	for (int s = 0; s < setCount; s++)
+	{
+		unsigned char *faces[SH_FACES] = { 0 };
+		int w = 0, h = 0, ok = 1;
+		for (int i = 0; i < SH_FACES && ok; i++)
+		{
+			char filename[1024];
+			int c;
+			snprintf(filename, sizeof(filename), "%s/%s.jpg", sets[s], sh_faceNames[i]);
+			faces[i] = stbi_load(filename, &w, &h, &c, 3);
+			ok = faces[i] != 0;
+			if (!ok)
+				fprintf(stderr, "Error loading %s\n", filename);
+		}
+
+		double reference[SH_COEFFICIENTS * 3];
+		ok = ok && projectReference((const unsigned char**)faces, w, h, reference);
+		// errors relative to the rms of the reference coefficients, comparable between sets
+		double magnitude = 0.0;
+		for (int i = 0; ok && i < SH_COEFFICIENTS * 3; i++)
+			magnitude += reference[i] * reference[i];
+		magnitude = sqrt(magnitude / (SH_COEFFICIENTS * 3));
+
+		config_t modes[64]; // at most 3 kernels x 6 steps x 2 weightings + 5 + 4;
+		int modeCount = ok ? addConfigs(modes, w) : 0;
+		for (int m = 0; m < modeCount; m++)
+		{
+			const config_t *mode = &modes[m];
+			int qmc = !strcmp(mode->name, "qmc");
+			int filtered = !strcmp(mode->name, "resolution");
+			m_vec3 coefficients[SH_COEFFICIENTS];
+			double ns = timeConfig((const unsigned char**)faces, w, h, mode, coefficients);
+			double rms = rmsError(coefficients, reference);
+			const char *kernel = qmc ? "-" : sh_kernel_name(mode->settings.kernel);
+			const char *weighting = qmc ? "-" : mode->settings.weighting == SH_WEIGHT_EXACT ? "exact" : "approx";
+			int step = qmc ? 0 : filtered ? 1 : mode->settings.step;
+			int resolution = filtered ? mode->settings.resolution : qmc ? 0 : w;
+			if (table)
+				printf("%-24s %5d %-10s %-6s %-6s %4d %5d %10d %12.0f %10.3g %10.3g\n", sets[s], w, mode->name,
+					kernel, weighting, step, resolution, mode->samples, ns, rms, rms / magnitude);
+			if (csv)
+				fprintf(csv, "%s,%d,%s,%s,%s,%d,%d,%d,%.0f,%.9g,%.9g\n", sets[s], w, mode->name,
+					kernel, weighting, step, resolution, mode->samples, ns, rms, rms / magnitude);
+		}
+		result |= !ok;
+
+		for (int i = 0; i < SH_FACES; i++)
+			stbi_image_free(faces[i]);
+	}
+
+	if (csv && csv != stdout && fclose(csv))
+	{
+		fprintf(stderr, "Error writing %s\n", csvFile);
+		result = 1;
+	}
+	return result;
+}
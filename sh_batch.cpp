@@ -0,0 +1,331 @@
+/***********************************************************
+* Headless batch projection of cubemap directories and     *
+* lat-long images                                          *
+* usage: shbatch [options] <cubemap dir | lat-long>...     *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "sh_project.h"
+#include "sh_pool.h"
+
+static const char *extensions[] = { ".jpg", ".png", ".hdr", ".tga", ".bmp" };
+
+typedef struct probe_t
+{
+	const char *dir;
+	int ok;
+	m_vec3 coefficients[SH_COEFFICIENTS];
+} probe_t;
+
+typedef struct batch_t
+{
+	probe_t *probes;
+	sh_settings settings;
+} batch_t;
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int fileExists(const char *filename)
+{
+	FILE *f = fopen(filename, "rb");
+	if (f)
+		fclose(f);
+	return f != 0;
+}
+
+static void projectProbe(void *user, int index)
+{
+	batch_t *batch = (batch_t*)user;
+	probe_t *probe = &batch->probes[index];
+
+	// a readable file (not a directory) is an equirectangular image
+	FILE *f = fopen(probe->dir, "rb");
+	if (f && fgetc(f) != EOF)
+	{
+		fclose(f);
+		probe->ok = sh_project_latlong_file(probe->dir, &batch->settings, probe->coefficients);
+		return;
+	}
+	if (f)
+		fclose(f);
+
+	// the first extension that exists for posx is used for all faces
+	const char *ext = 0;
+	char filenames[SH_FACES][1024];
+	const char *files[SH_FACES];
+	for (int e = 0; e < (int)(sizeof(extensions) / sizeof(extensions[0])) && !ext; e++)
+	{
+		snprintf(filenames[0], sizeof(filenames[0]), "%s/%s%s", probe->dir, sh_faceNames[0], extensions[e]);
+		if (fileExists(filenames[0]))
+			ext = extensions[e];
+	}
+	if (!ext)
+	{
+		fprintf(stderr, "Error: no %s image in %s\n", sh_faceNames[0], probe->dir);
+		return;
+	}
+	for (int i = 0; i < SH_FACES; i++)
+	{
+		snprintf(filenames[i], sizeof(filenames[i]), "%s/%s%s", probe->dir, sh_faceNames[i], ext);
+		files[i] = filenames[i];
+	}
+	probe->ok = sh_project_cubemap_files(files, &batch->settings, probe->coefficients);
+}
+
+static int writeBinary(const char *filename, const probe_t *probes, int count)
+{
+	FILE *f = fopen(filename, "wb");
+	if (!f)
+		return 0;
+	unsigned int header[2] = { (unsigned int)count, SH_COEFFICIENTS };
+	fwrite("SHBATCH1", 8, 1, f);
+	fwrite(header, sizeof(header), 1, f);
+	for (int i = 0; i < count; i++)
+	{
+		unsigned int ok = probes[i].ok;
+		fwrite(&ok, sizeof(ok), 1, f);
+		fwrite(probes[i].coefficients, sizeof(probes[i].coefficients), 1, f);
+	}
+	int result = !ferror(f);
+	fclose(f);
+	return result;
+}
+
+static void writeJsonString(FILE *f, const char *s)
+{
+	fputc('"', f);
+	for (; *s; s++)
+	{
+		if (*s == '"' || *s == '\\')
+			fputc('\\', f);
+		if ((unsigned char)*s < 0x20)
+			fprintf(f, "\\u%04x", *s);
+		else
+			fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+static int writeJson(const char *filename, const probe_t *probes, int count)
+{
+	FILE *f = strcmp(filename, "-") ? fopen(filename, "w") : stdout;
+	if (!f)
+		return 0;
+	fprintf(f, "[\n");
+	for (int i = 0; i < count; i++)
+	{
+		fprintf(f, "  { \"dir\": ");
+		writeJsonString(f, probes[i].dir);
+		fprintf(f, ", \"ok\": %s", probes[i].ok ? "true" : "false");
+		if (probes[i].ok)
+		{
+			fprintf(f, ", \"coefficients\": [");
+			for (int k = 0; k < SH_COEFFICIENTS; k++)
+			{
+				m_vec3 c = probes[i].coefficients[k];
+				fprintf(f, "%s[%.9g, %.9g, %.9g]", k ? ", " : "", c.x, c.y, c.z);
+			}
+			fprintf(f, "]");
+		}
+		fprintf(f, " }%s\n", i + 1 < count ? "," : "");
+	}
+	fprintf(f, "]\n");
+	int result = !ferror(f);
+	if (f != stdout)
+		fclose(f);
+	return result;
+}
+
+// <dir>/<probe index>_<face>.hdr for every probe that was projected
+static int bakeCubemaps(const char *dir, int size, const probe_t *probes, int count, const sh_settings *settings)
+{
+	float *faces[SH_FACES];
+	float *pixels = (float*)malloc((size_t)SH_FACES * size * size * 3 * sizeof(float));
+	if (!pixels)
+		return 0;
+	for (int i = 0; i < SH_FACES; i++)
+		faces[i] = pixels + (size_t)i * size * size * 3;
+	int result = 1;
+	for (int p = 0; p < count && result; p++)
+	{
+		if (!probes[p].ok)
+			continue;
+		result = sh_reconstruct_cubemap(probes[p].coefficients, size, settings, faces);
+		for (int i = 0; i < SH_FACES && result; i++)
+		{
+			char filename[1024];
+			snprintf(filename, sizeof(filename), "%s/%d_%s.hdr", dir, p, sh_faceNames[i]);
+			if (!sh_write_hdr(filename, faces[i], size, size))
+			{
+				fprintf(stderr, "Error writing %s\n", filename);
+				result = 0;
+			}
+		}
+	}
+	free(pixels);
+	return result;
+}
+
+// "lambert", "phong:<exponent>" or "gaussian:<width>" to per band factors
+static int parseKernel(const char *kernel, float *factors)
+{
+	if (!strcmp(kernel, "lambert"))
+		sh_lambert_factors(3, factors);
+	else if (!strncmp(kernel, "phong:", 6) && atof(kernel + 6) >= 0.0)
+		sh_phong_factors(3, (float)atof(kernel + 6), factors);
+	else if (!strncmp(kernel, "gaussian:", 9))
+		sh_gaussian_factors(3, (float)atof(kernel + 9), factors);
+	else
+		return 0;
+	return 1;
+}
+
+static void usage()
+{
+	printf("usage: shbatch [options] <cubemap dir | lat-long image>...\n"
+		"every dir holds posx, negx, posy, negy, posz, negz (.jpg, .png, .hdr, .tga or .bmp),\n"
+		"image files are projected as equirectangular (360 x 180 degree) environments\n"
+		"  -json <file>        write coefficients as JSON (- for stdout)\n"
+		"  -bin <file>         write coefficients as binary: \"SHBATCH1\", uint32 probe count,\n"
+		"                      uint32 coefficient count, then per probe uint32 ok + float rgb[count]\n"
+		"  -step <n>           project every n'th texel (default 16)\n"
+		"  -resolution <n>     area filter the faces to n x n (lat-long: 4n x 2n) and project every texel\n"
+		"  -exact              exact texel solid angles\n"
+		"  -threads <n>        worker threads (default: all)\n"
+		"  -cache <file>       coefficient cache, unchanged probes are not projected again\n"
+		"  -stream             project the images row by row while they are decoded, so memory\n"
+		"                      does not grow with the image size (same coefficients)\n"
+		"  -convolve <kernel>  convolve the radiance coefficients with lambert, phong:<exponent>\n"
+		"                      or gaussian:<width in radians> before writing them\n"
+		"  -bake <size> <dir>  evaluate the (convolved) coefficients into size x size .hdr faces\n"
+		"                      <dir>/<probe index>_<face>.hdr, e.g. -convolve lambert for irradiance maps\n");
+}
+
+int main(int argc, char *argv[])
+{
+	batch_t batch;
+	sh_settings_init(&batch.settings);
+	const char *jsonFile = 0, *binFile = 0;
+	const char *bakeDir = 0;
+	int threads = 0, convolve = 0, bakeSize = 0;
+	float factors[3];
+
+	probe_t *probes = (probe_t*)calloc(argc, sizeof(probe_t));
+	int count = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		int hasValue = i + 1 < argc;
+		if (!strcmp(arg, "-json") && hasValue)
+			jsonFile = argv[++i];
+		else if (!strcmp(arg, "-bin") && hasValue)
+			binFile = argv[++i];
+		else if (!strcmp(arg, "-step") && hasValue)
+			batch.settings.step = atoi(argv[++i]);
+		else if (!strcmp(arg, "-resolution") && hasValue)
+			batch.settings.resolution = atoi(argv[++i]);
+		else if (!strcmp(arg, "-exact"))
+			batch.settings.weighting = SH_WEIGHT_EXACT;
+		else if (!strcmp(arg, "-threads") && hasValue)
+			threads = atoi(argv[++i]);
+		else if (!strcmp(arg, "-cache") && hasValue)
+			batch.settings.cacheFile = argv[++i];
+		else if (!strcmp(arg, "-stream"))
+			batch.settings.stream = 1;
+		else if (!strcmp(arg, "-convolve") && hasValue && parseKernel(argv[i + 1], factors))
+		{
+			convolve = 1;
+			i++;
+		}
+		else if (!strcmp(arg, "-bake") && i + 2 < argc && atoi(argv[i + 1]) > 0)
+		{
+			bakeSize = atoi(argv[++i]);
+			bakeDir = argv[++i];
+		}
+		else if (arg[0] == '-')
+		{
+			usage();
+			free(probes);
+			return arg[1] == 'h' ? 0 : 1;
+		}
+		else
+			probes[count++].dir = arg;
+	}
+	if (!count || batch.settings.step < 1)
+	{
+		usage();
+		free(probes);
+		return 1;
+	}
+	batch.probes = probes;
+
+	// probes are handed out one by one from the shared pool, so fast and slow
+	// probes balance out. with fewer probes than threads, every probe gets
+	// all threads instead (nested parallel loops run serially).
+	int workers = threads > 0 ? threads : sh_hardware_threads();
+	double start = now();
+	if (count >= workers)
+	{
+		batch.settings.threads = 1;
+		sh_parallel_for(count, workers, projectProbe, &batch);
+	}
+	else
+	{
+		batch.settings.threads = workers;
+		for (int i = 0; i < count; i++)
+			projectProbe(&batch, i);
+	}
+	double seconds = now() - start;
+
+	int failed = 0;
+	for (int i = 0; i < count; i++)
+	{
+		failed += !probes[i].ok;
+		if (convolve)
+			sh_convolve(probes[i].coefficients, factors, 1);
+	}
+	fprintf(stderr, "%d probes (%d failed) in %.3f s on %d threads: %.2f probes/sec\n",
+		count, failed, seconds, workers, count / seconds);
+
+	int result = failed ? 1 : 0;
+	if (batch.settings.cacheFile && !sh_flush_cache()) // new records in one go
+	{
+		fprintf(stderr, "Error writing %s\n", batch.settings.cacheFile);
+		result = 1;
+	}
+	if (jsonFile && !writeJson(jsonFile, probes, count))
+	{
+		fprintf(stderr, "Error writing %s\n", jsonFile);
+		result = 1;
+	}
+	if (binFile && !writeBinary(binFile, probes, count))
+	{
+		fprintf(stderr, "Error writing %s\n", binFile);
+		result = 1;
+	}
+	if (bakeDir)
+	{
+		batch.settings.threads = workers;
+		start = now();
+		if (!bakeCubemaps(bakeDir, bakeSize, probes, count, &batch.settings))
+			result = 1;
+		fprintf(stderr, "baked %d x %d cubemaps in %.3f s\n", bakeSize, bakeSize, now() - start);
+	}
+	free(probes);
+	return result;
+}
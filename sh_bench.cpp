@@ -0,0 +1,269 @@
+/***********************************************************
+* Benchmark of the SH projection kernels                   *
+* usage: shbench [cubemap dir...]                          *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+
+#include "stb_image.h"
+#include "sh_project.h"
+
+static const char *defaultSets[] =
+{
+	"cubemaps/bridge3/",
+	"cubemaps/coittower2/",
+	"cubemaps/colors/",
+	"cubemaps/powerlines/",
+	"cubemaps/room/",
+	"cubemaps/tantolunden2/"
+};
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// best of a few runs, in milliseconds. projects the float faces if given.
+static double timeProjection(const unsigned char **faces, const float **floatFaces, int w, int h, const sh_settings *settings, m_vec3 *coefficients)
+{
+	double best = 1e30;
+	double total = 0.0;
+	for (int run = 0; run < 20 && (run < 3 || total < 0.5); run++)
+	{
+		double start = now();
+		if (floatFaces)
+			sh_project_cubemap_rgbf(floatFaces, w, h, settings, coefficients);
+		else
+			sh_project_cubemap_rgb8(faces, w, h, settings, coefficients);
+		double t = now() - start;
+		total += t;
+		best = t < best ? t : best;
+	}
+	return best * 1000.0;
+}
+
+// per frame cost of turning the environment of many probes, in microseconds
+static double timeRotation(int probes)
+{
+	m_vec3 *coefficients = (m_vec3*)malloc((size_t)probes * SH_COEFFICIENTS * sizeof(m_vec3));
+	if (!coefficients)
+		return 0.0;
+	for (int i = 0; i < probes * SH_COEFFICIENTS; i++)
+		coefficients[i] = m_v3((float)(i % 7), (float)(i % 5), (float)(i % 3));
+	double best = 1e30;
+	for (int run = 0; run < 20; run++)
+	{
+		double start = now();
+		sh_rotation rotation;
+		sh_rotation_init(&rotation, m_axisAngleq(m_v3(0.0f, 1.0f, 0.0f), (float)run));
+		sh_rotate(&rotation, coefficients, coefficients, probes);
+		double t = now() - start;
+		best = t < best ? t : best;
+	}
+	free(coefficients);
+	return best * 1000000.0;
+}
+
+// irradiance map of one probe on one thread, in microseconds
+static double timeBake(int size, sh_kernel kernel)
+{
+	m_vec3 coefficients[SH_COEFFICIENTS];
+	for (int i = 0; i < SH_COEFFICIENTS; i++)
+		coefficients[i] = m_v3((float)(i % 7), (float)(i % 5), (float)(i % 3));
+	float *pixels = (float*)malloc((size_t)SH_FACES * size * size * 3 * sizeof(float));
+	if (!pixels)
+		return 0.0;
+	float *faces[SH_FACES];
+	for (int i = 0; i < SH_FACES; i++)
+		faces[i] = pixels + (size_t)i * size * size * 3;
+	sh_settings settings;
+	sh_settings_init(&settings);
+	settings.threads = 1;
+	settings.kernel = kernel;
+	double best = 1e30;
+	for (int run = 0; run < 20; run++)
+	{
+		double start = now();
+		sh_reconstruct_cubemap(coefficients, size, &settings, faces);
+		double t = now() - start;
+		best = t < best ? t : best;
+	}
+	free(pixels);
+	return best * 1000000.0;
+}
+
+// per probe decode cost of packed coefficient sets, in nanoseconds
+static double timeUnpack(sh_pack_format format, const void *packed, int count, sh_kernel kernel, m_vec3 *coefficients)
+{
+	double best = 1e30;
+	for (int run = 0; run < 10; run++)
+	{
+		double start = now();
+		sh_unpack(format, packed, count, kernel, coefficients);
+		double t = now() - start;
+		best = t < best ? t : best;
+	}
+	return best * 1e9 / count;
+}
+
+// error and decode speed of the packed formats, for many rotated copies of
+// the projected sets (a probe set is rarely one environment)
+static void benchmarkPacking(const m_vec3 *projected, int sets, const sh_kernel *kernels, int kernelCount)
+{
+	const int count = 1 << 18;
+	m_vec3 *probes = (m_vec3*)malloc((size_t)count * SH_COEFFICIENTS * sizeof(m_vec3));
+	m_vec3 *unpacked = (m_vec3*)malloc((size_t)count * SH_COEFFICIENTS * sizeof(m_vec3));
+	void *packed = malloc((size_t)count * sh_pack_size(SH_PACK_HALF));
+	if (probes && unpacked && packed)
+	{
+		for (int p = 0; p < count; p++)
+		{
+			sh_rotation rotation;
+			sh_rotation_init(&rotation, m_axisAngleq(m_normalize3(m_v3(sinf((float)p), 1.0f, cosf(p * 0.5f))), p * 0.618f));
+			sh_rotate(&rotation, projected + (p % sets) * SH_COEFFICIENTS, probes + (size_t)p * SH_COEFFICIENTS, 1);
+		}
+		const sh_pack_format formats[] = { SH_PACK_HALF, SH_PACK_RATIO8 };
+		for (int f = 0; f < (int)(sizeof(formats) / sizeof(formats[0])); f++)
+		{
+			sh_pack_error error;
+			sh_pack_report(formats[f], probes, count, &error);
+			size_t size = sh_pack_size(formats[f]);
+			printf("pack %-6s %2d bytes (%.1fx smaller): rms error %.3g, max %.3g (%.3g of coefficient 0)\n", sh_pack_name(formats[f]),
+				(int)size, SH_COEFFICIENTS * sizeof(m_vec3) / (double)size, error.rms, error.max, error.relative);
+			sh_pack(formats[f], probes, count, packed);
+			for (int k = 0; k < kernelCount; k++)
+				if (sh_kernel_supported(kernels[k]))
+					printf("unpack %-6s of %d probes (%-6s): %10.3f ns/probe\n", sh_pack_name(formats[f]), count,
+						sh_kernel_name(kernels[k]), timeUnpack(formats[f], packed, count, kernels[k], unpacked));
+		}
+	}
+	free(probes);
+	free(unpacked);
+	free(packed);
+}
+
+static float maxError(const m_vec3 *a, const m_vec3 *b)
+{
+	float e = 0.0f;
+	for (int i = 0; i < SH_COEFFICIENTS; i++)
+		e = m_maxf(e, m_length3(m_sub3(a[i], b[i])));
+	return e;
+}
+
+int main(int argc, char *argv[])
+{
+	const char **sets = argc > 1 ? (const char**)argv + 1 : defaultSets;
+	int setCount = argc > 1 ? argc - 1 : (int)(sizeof(defaultSets) / sizeof(defaultSets[0]));
+	const sh_kernel kernels[] = { SH_KERNEL_SCALAR, SH_KERNEL_SSE2, SH_KERNEL_AVX2 };
+	const int steps[] = { 1, 4, 16 };
+
+	m_vec3 *projected = (m_vec3*)malloc((size_t)setCount * SH_COEFFICIENTS * sizeof(m_vec3));
+	int projectedCount = 0;
+
+	printf("%-24s %5s %4s %-11s %10s %8s %10s\n", "set", "size", "step", "kernel", "ms", "speedup", "max error");
+	for (int s = 0; s < setCount; s++)
+	{
+		unsigned char *faces[SH_FACES] = { 0 };
+		float *floatFaces[SH_FACES] = { 0 };
+		int w = 0, h = 0, ok = 1;
+		for (int i = 0; i < SH_FACES && ok; i++)
+		{
+			char filename[1024];
+			int c;
+			snprintf(filename, sizeof(filename), "%s/%s.jpg", sets[s], sh_faceNames[i]);
+			faces[i] = stbi_load(filename, &w, &h, &c, 3);
+			ok = faces[i] != 0;
+			if (!ok)
+				fprintf(stderr, "Error loading %s\n", filename);
+		}
+
+		// the same data as linear floats, for the HDR path
+		for (int i = 0; i < SH_FACES && ok; i++)
+		{
+			floatFaces[i] = (float*)malloc((size_t)w * h * 3 * sizeof(float));
+			ok = floatFaces[i] != 0;
+			for (size_t j = 0; ok && j < (size_t)w * h * 3; j++)
+				floatFaces[i][j] = faces[i][j] / 255.0f;
+		}
+
+		for (int si = 0; ok && si < (int)(sizeof(steps) / sizeof(steps[0])); si++)
+		{
+			m_vec3 reference[SH_COEFFICIENTS];
+			double scalarMs = 0.0;
+			for (int k = 0; k < 2 * (int)(sizeof(kernels) / sizeof(kernels[0])); k++)
+			{
+				sh_kernel kernel = kernels[k / 2];
+				int hdr = k & 1;
+				if (!sh_kernel_supported(kernel))
+					continue;
+				sh_settings settings;
+				sh_settings_init(&settings);
+				settings.step = steps[si];
+				settings.threads = 1;
+				settings.kernel = kernel;
+				m_vec3 coefficients[SH_COEFFICIENTS];
+				double ms = timeProjection((const unsigned char**)faces, hdr ? (const float**)floatFaces : 0, w, h, &settings, coefficients);
+				if (kernel == SH_KERNEL_SCALAR && !hdr)
+				{
+					scalarMs = ms;
+					for (int i = 0; i < SH_COEFFICIENTS; i++)
+						reference[i] = coefficients[i];
+					if (steps[si] == 1 && projected)
+						for (int i = 0; i < SH_COEFFICIENTS; i++)
+							projected[projectedCount * SH_COEFFICIENTS + i] = coefficients[i];
+					projectedCount += steps[si] == 1 && projected;
+				}
+				char name[32];
+				snprintf(name, sizeof(name), "%s%s", sh_kernel_name(kernel), hdr ? " f32" : "");
+				printf("%-24s %5d %4d %-11s %10.3f %7.2fx %10.3g\n", sets[s], w, steps[si], name,
+					ms, scalarMs / ms, maxError(coefficients, reference));
+			}
+		}
+
+		if (ok)
+		{
+			// a time budget instead of a step, against the projection of every texel
+			sh_settings settings;
+			sh_settings_init(&settings);
+			settings.step = 1;
+			settings.threads = 1;
+			m_vec3 reference[SH_COEFFICIENTS], coefficients[SH_COEFFICIENTS], error[SH_COEFFICIENTS], zero[SH_COEFFICIENTS] = {};
+			sh_project_cubemap_rgb8((const unsigned char**)faces, w, h, &settings, reference);
+			int samples = sh_project_cubemap_qmc_rgb8((const unsigned char**)faces, w, h, 0, 0.0005, coefficients, error);
+			printf("%-24s %5d qmc in 0.5 ms: %d samples, max error %.3g (estimated %.3g)\n", sets[s], w,
+				samples, maxError(coefficients, reference), maxError(error, zero));
+		}
+
+		for (int i = 0; i < SH_FACES; i++)
+		{
+			stbi_image_free(faces[i]);
+			free(floatFaces[i]);
+		}
+	}
+
+	const int probes[] = { 1, 1024, 4096 };
+	for (int i = 0; i < (int)(sizeof(probes) / sizeof(probes[0])); i++)
+		printf("rotation of %5d coefficient sets: %10.3f us\n", probes[i], timeRotation(probes[i]));
+	if (projectedCount)
+		benchmarkPacking(projected, projectedCount, kernels, (int)(sizeof(kernels) / sizeof(kernels[0])));
+	free(projected);
+
+	const int bakeSizes[] = { 32, 128 };
+	for (int i = 0; i < (int)(sizeof(bakeSizes) / sizeof(bakeSizes[0])); i++)
+		for (int k = 0; k < (int)(sizeof(kernels) / sizeof(kernels[0])); k++)
+			if (sh_kernel_supported(kernels[k]))
+				printf("bake of a %3d x %3d cubemap (%-6s): %10.3f us\n", bakeSizes[i], bakeSizes[i],
+					sh_kernel_name(kernels[k]), timeBake(bakeSizes[i], kernels[k]));
+	return 0;
+}
@@ -0,0 +1,191 @@
+/***********************************************************
+* On-disk cache of projected coefficients, keyed by a hash *
+* of the face file contents and the projection settings    *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sh_kernel.h"
+
+// bump whenever the projection changes its results
+#define SH__CACHE_VERSION 2 // 2: radiance instead of lambert convolved coefficients
+
+// file layout: magic, then records until the end of the file. the records of
+// every cache file in use are kept in memory and written back by sh_flush_cache.
+static const char sh__cacheMagic[8] = { 'S', 'H', 'C', 'A', 'C', 'H', 'E', '1' };
+
+typedef struct sh__cache_record
+{
+	unsigned long long key;
+	m_vec3 coefficients[SH_COEFFICIENTS];
+} sh__cache_record;
+
+typedef struct sh__cache_entry
+{
+	m_vec3 coefficients[SH_COEFFICIENTS];
+} sh__cache_entry;
+
+typedef struct sh__cache_file
+{
+	std::unordered_map<unsigned long long, sh__cache_entry> records;
+	int dirty; // records that are not in the file yet
+} sh__cache_file;
+
+static std::mutex sh__cacheMutex;
+static std::unordered_map<std::string, sh__cache_file> sh__caches; // by file name
+
+static unsigned long long sh__mix(unsigned long long h, unsigned long long v)
+{
+	h ^= v * 0x9E3779B97F4A7C15ull;
+	h = (h << 27) | (h >> 37);
+	return h * 0xC2B2AE3D27D4EB4Full + 0x165667B19E3779F9ull;
+}
+
+// 8 bytes per step, four independent lanes so the multiplies overlap
+static int sh__hash_file(const char *file, unsigned long long *hash)
+{
+	FILE *f = fopen(file, "rb");
+	if (!f)
+		return 0;
+	unsigned long long lanes[4] = { *hash, *hash + 1, *hash + 2, *hash + 3 };
+	unsigned long long size = 0;
+	static const size_t chunk = 1 << 16;
+	unsigned long long buffer[(1 << 16) / 8];
+	size_t n;
+	while ((n = fread(buffer, 1, chunk, f)) > 0)
+	{
+		if (n & 7) // only at the end of the file
+			memset((char*)buffer + n, 0, 8 - (n & 7));
+		size_t words = (n + 7) / 8;
+		for (size_t i = 0; i < words; i++)
+			lanes[i & 3] = sh__mix(lanes[i & 3], buffer[i]);
+		size += n;
+	}
+	int ok = !ferror(f);
+	fclose(f);
+	*hash = sh__mix(sh__mix(sh__mix(sh__mix(size, lanes[0]), lanes[1]), lanes[2]), lanes[3]);
+	return ok;
+}
+
+int sh__cache_key(const char **files, int count, const sh_settings *settings, sh__format format, int scaledDecode, unsigned long long *key)
+{
+	unsigned long long h = sh__mix(SH__CACHE_VERSION, count); // 6 faces or 1 lat-long image
+	for (int i = 0; i < count; i++)
+		if (!sh__hash_file(files[i], &h))
+			return 0;
+	// everything that changes the result; threads and the kernel only change rounding
+	int resolution = settings->resolution > 0 ? settings->resolution : 0;
+	h = sh__mix(h, SH_COEFFICIENTS);
+	h = sh__mix(h, resolution ? 1 : settings->step);
+	h = sh__mix(h, resolution);
+	h = sh__mix(h, settings->weighting);
+	h = sh__mix(h, format);
+	h = sh__mix(h, scaledDecode);
+	*key = h;
+	return 1;
+}
+
+// call with sh__cacheMutex held: the records of a cache file, read once on first use
+static sh__cache_file &sh__cache_open(const char *cacheFile)
+{
+	std::unordered_map<std::string, sh__cache_file>::iterator it = sh__caches.find(cacheFile);
+	if (it != sh__caches.end())
+		return it->second;
+	sh__cache_file &cache = sh__caches[cacheFile];
+	cache.dirty = 0;
+	FILE *f = fopen(cacheFile, "rb");
+	if (!f)
+		return cache;
+	char magic[sizeof(sh__cacheMagic)];
+	if (fread(magic, sizeof(magic), 1, f) == 1 && !memcmp(magic, sh__cacheMagic, sizeof(magic)))
+	{
+		sh__cache_record record;
+		while (fread(&record, sizeof(record), 1, f) == 1)
+			memcpy(cache.records[record.key].coefficients, record.coefficients, sizeof(record.coefficients)); // the last record wins
+	}
+	else
+		cache.dirty = 1; // foreign or old file: start over on the next flush
+	fclose(f);
+	return cache;
+}
+
+int sh__cache_load(const char *cacheFile, unsigned long long key, m_vec3 *coefficients)
+{
+	std::unique_lock<std::mutex> lock(sh__cacheMutex);
+	sh__cache_file &cache = sh__cache_open(cacheFile);
+	std::unordered_map<unsigned long long, sh__cache_entry>::const_iterator it = cache.records.find(key);
+	if (it == cache.records.end())
+		return 0;
+	memcpy(coefficients, it->second.coefficients, sizeof(it->second.coefficients));
+	return 1;
+}
+
+void sh__cache_store(const char *cacheFile, unsigned long long key, const m_vec3 *coefficients)
+{
+	std::unique_lock<std::mutex> lock(sh__cacheMutex);
+	sh__cache_file &cache = sh__cache_open(cacheFile);
+	memcpy(cache.records[key].coefficients, coefficients, sizeof(cache.records[key].coefficients));
+	cache.dirty = 1;
+}
+
+int sh_flush_cache(void)
+{
+	std::unique_lock<std::mutex> lock(sh__cacheMutex);
+	int result = 1;
+	for (std::unordered_map<std::string, sh__cache_file>::iterator it = sh__caches.begin(); it != sh__caches.end(); ++it)
+	{
+		sh__cache_file &cache = it->second;
+		if (!cache.dirty)
+			continue;
+
+		// one record per key, sorted so unchanged caches give identical files
+		std::vector<unsigned long long> keys;
+		keys.reserve(cache.records.size());
+		for (std::unordered_map<unsigned long long, sh__cache_entry>::const_iterator r = cache.records.begin(); r != cache.records.end(); ++r)
+			keys.push_back(r->first);
+		std::sort(keys.begin(), keys.end());
+
+		// written next to the cache and renamed, so an interrupted run keeps the old file
+		std::string temp = it->first + ".tmp";
+		FILE *f = fopen(temp.c_str(), "wb");
+		int ok = f && fwrite(sh__cacheMagic, sizeof(sh__cacheMagic), 1, f) == 1;
+		for (size_t i = 0; i < keys.size() && ok; i++)
+		{
+			sh__cache_record record;
+			memset(&record, 0, sizeof(record));
+			record.key = keys[i];
+			memcpy(record.coefficients, cache.records[keys[i]].coefficients, sizeof(record.coefficients));
+			ok = fwrite(&record, sizeof(record), 1, f) == 1;
+		}
+		if (f && fclose(f))
+			ok = 0;
+		remove(ok ? it->first.c_str() : temp.c_str()); // rename does not replace files everywhere
+		if (ok && rename(temp.c_str(), it->first.c_str()))
+			ok = 0;
+		if (ok)
+			cache.dirty = 0;
+		else
+			result = 0;
+	}
+	return result;
+}
+
+// records that were not flushed explicitly are written when the program exits
+static struct sh__cache_flusher
+{
+	~sh__cache_flusher() { sh_flush_cache(); }
+} sh__cacheFlusher;
@@ -0,0 +1,56 @@
+/***********************************************************
+* Zonal harmonic convolution kernels for radiance SH       *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <math.h>
+
+#include "sh_project.h"
+
+// a rotationally symmetric kernel k(cos) becomes one factor per band (Funk-Hecke):
+//   factors[l] = 2 pi integral_-1^1 k(t) P_l(t) dt
+// all kernels here integrate to 1 over the sphere, so factors[0] is 1.
+
+void sh_phong_factors(int bands, float exponent, float *factors)
+{
+	// k(t) = (n + 1) / (2 pi) max(t, 0)^n, so factors[l] = (n + 1) I_l with
+	// I_l = integral_0^1 t^n P_l(t) dt = (n - l + 2) / (n + l + 1) I_(l-2)
+	double n = exponent, I[2] = { 1.0 / (n + 1.0), 1.0 / (n + 2.0) };
+	for (int l = 0; l < bands; l++)
+	{
+		if (l >= 2)
+			I[l & 1] *= (n - l + 2.0) / (n + l + 1.0);
+		factors[l] = (float)((n + 1.0) * I[l & 1]);
+	}
+}
+
+void sh_lambert_factors(int bands, float *factors)
+{
+	sh_phong_factors(bands, 1.0f, factors); // 1, 2/3, 1/4, 0, -1/24, ...
+}
+
+void sh_gaussian_factors(int bands, float width, float *factors)
+{
+	// heat kernel on the sphere, close to exp((cos - 1) / width^2) for small widths
+	for (int l = 0; l < bands; l++)
+		factors[l] = expf(-0.5f * l * (l + 1) * width * width);
+}
+
+void sh_convolve(m_vec3 *coefficients, const float *factors, int count)
+{
+	for (int p = 0; p < count; p++, coefficients += SH_COEFFICIENTS)
+	{
+		coefficients[0] = m_scale3(coefficients[0], factors[0]);
+		for (int i = 1; i < 4; i++)
+			coefficients[i] = m_scale3(coefficients[i], factors[1]);
+		for (int i = 4; i < 9; i++)
+			coefficients[i] = m_scale3(coefficients[i], factors[2]);
+	}
+}
@@ -0,0 +1,176 @@
+/***********************************************************
+* Area filtered downsampling of cubemap faces              *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sh_project.h"
+#include "sh_kernel.h"
+#include "sh_pool.h"
+
+typedef struct sh__downsample
+{
+	const void **faces;
+	void **out;
+	int w, h, dw, dh;
+	int *xEdge; // [dw + 1] first source column of every output column
+} sh__downsample;
+
+// sum types per channel type: one output texel of a source row, and all rows
+template <typename T> struct sh__sums;
+template <> struct sh__sums<unsigned char> { typedef unsigned int run; typedef unsigned long long total; };
+template <> struct sh__sums<float> { typedef double run; typedef double total; };
+
+static inline unsigned char sh__average(unsigned long long sum, unsigned long long n) { return (unsigned char)((sum + n / 2) / n); }
+static inline float sh__average(double sum, unsigned long long n) { return (float)(sum / n); }
+
+// adds one source row to the sums of its output row
+template <typename T>
+static void sh__downsample_add(typename sh__sums<T>::total *sum, const T *p, const int *xEdge, int dw)
+{
+	typedef typename sh__sums<T>::run run;
+	for (int i = 0; i < dw; i++)
+	{
+		run r = 0, g = 0, b = 0;
+		for (int x = xEdge[i]; x < xEdge[i + 1]; x++, p += 3)
+		{
+			r += p[0]; g += p[1]; b += p[2];
+		}
+		sum[i * 3 + 0] += r; sum[i * 3 + 1] += g; sum[i * 3 + 2] += b;
+	}
+}
+
+template <typename T>
+static void sh__downsample_store(T *o, const typename sh__sums<T>::total *sum, const int *xEdge, int dw, int rows)
+{
+	for (int i = 0; i < dw; i++)
+	{
+		unsigned long long n = (unsigned long long)(xEdge[i + 1] - xEdge[i]) * rows;
+		for (int c = 0; c < 3; c++)
+			o[i * 3 + c] = sh__average(sum[i * 3 + c], n);
+	}
+}
+
+// one output row: the source rows are summed up front to back, so the
+// source is read exactly once and strictly in memory order
+template <typename T>
+static void sh__downsample_row(void *user, int index)
+{
+	typedef typename sh__sums<T>::total total;
+	sh__downsample *d = (sh__downsample*)user;
+	int face = index / d->dh, j = index % d->dh;
+	int y0 = (int)((long long)j * d->h / d->dh), y1 = (int)((long long)(j + 1) * d->h / d->dh);
+
+	total *sum = (total*)calloc((size_t)d->dw * 3, sizeof(total));
+	if (!sum)
+		return; // leaves the row black
+	for (int y = y0; y < y1; y++)
+		sh__downsample_add<T>(sum, (const T*)d->faces[face] + (size_t)y * d->w * 3, d->xEdge, d->dw);
+	sh__downsample_store<T>((T*)d->out[face] + (size_t)j * d->dw * 3, sum, d->xEdge, d->dw, y1 - y0);
+	free(sum);
+}
+
+static int sh__downsample_faces(sh_task row, int count, const void **faces, int w, int h, int dw, int dh, int threads, void **out)
+{
+	if (dw < 1 || dh < 1 || dw > w || dh > h)
+		return 0;
+	sh__downsample d = { faces, out, w, h, dw, dh, (int*)malloc((dw + 1) * sizeof(int)) };
+	if (!d.xEdge)
+		return 0;
+	for (int i = 0; i <= dw; i++)
+		d.xEdge[i] = (int)((long long)i * w / dw);
+	sh_parallel_for(count * dh, threads, row, &d);
+	free(d.xEdge);
+	return 1;
+}
+
+int sh_downsample_cubemap_rgb8(const unsigned char **faces, int w, int h, int dw, int dh, int threads, unsigned char **out)
+{
+	return sh__downsample_faces(sh__downsample_row<unsigned char>, SH_FACES, (const void**)faces, w, h, dw, dh, threads, (void**)out);
+}
+
+int sh_downsample_face_rgb8(const unsigned char *rgb, int w, int h, int dw, int dh, int threads, unsigned char *out)
+{
+	const void *face = rgb;
+	void *outFace = out;
+	return sh__downsample_faces(sh__downsample_row<unsigned char>, 1, &face, w, h, dw, dh, threads, &outFace);
+}
+
+int sh_downsample_cubemap_rgbf(const float **faces, int w, int h, int dw, int dh, int threads, float **out)
+{
+	return sh__downsample_faces(sh__downsample_row<float>, SH_FACES, (const void**)faces, w, h, dw, dh, threads, (void**)out);
+}
+
+int sh_downsample_face_rgbf(const float *rgb, int w, int h, int dw, int dh, int threads, float *out)
+{
+	const void *face = rgb;
+	void *outFace = out;
+	return sh__downsample_faces(sh__downsample_row<float>, 1, &face, w, h, dw, dh, threads, &outFace);
+}
+
+int sh__row_filter_init(sh__row_filter *filter, sh__format format, int w, int h, int dw, int dh)
+{
+	memset(filter, 0, sizeof(sh__row_filter));
+	if (dw < 1 || dh < 1 || dw > w || dh > h)
+		return 0;
+	filter->format = format;
+	filter->w = w;
+	filter->h = h;
+	filter->dw = dw;
+	filter->dh = dh;
+	filter->xEdge = (int*)malloc((dw + 1) * sizeof(int));
+	filter->sums = calloc((size_t)dw * 3, sizeof(double)); // both sum types are 8 bytes
+	filter->row = malloc((size_t)dw * sh__texel_size(format));
+	if (!filter->xEdge || !filter->sums || !filter->row)
+	{
+		sh__row_filter_free(filter);
+		return 0;
+	}
+	for (int i = 0; i <= dw; i++)
+		filter->xEdge[i] = (int)((long long)i * w / dw);
+	filter->y1 = (int)((long long)h / dh);
+	return 1;
+}
+
+void sh__row_filter_free(sh__row_filter *filter)
+{
+	free(filter->xEdge);
+	free(filter->sums);
+	free(filter->row);
+	memset(filter, 0, sizeof(sh__row_filter));
+}
+
+template <typename T>
+static const void *sh__row_filter_add_row(sh__row_filter *f, const T *row)
+{
+	typedef typename sh__sums<T>::total total;
+	total *sum = (total*)f->sums;
+	sh__downsample_add<T>(sum, row, f->xEdge, f->dw);
+	if (++f->y < f->y1)
+		return 0;
+	// same rows as sh__downsample_row
+	int y0 = (int)((long long)f->j * f->h / f->dh);
+	sh__downsample_store<T>((T*)f->row, sum, f->xEdge, f->dw, f->y1 - y0);
+	memset(sum, 0, (size_t)f->dw * 3 * sizeof(total));
+	f->j++;
+	f->y1 = (int)((long long)(f->j + 1) * f->h / f->dh);
+	return f->row;
+}
+
+const void *sh__row_filter_add(sh__row_filter *filter, const void *row)
+{
+	if (filter->j >= filter->dh)
+		return 0;
+	if (filter->format == SH__RGBF)
+		return sh__row_filter_add_row(filter, (const float*)row);
+	return sh__row_filter_add_row(filter, (const unsigned char*)row);
+}
@@ -0,0 +1,247 @@
+/***********************************************************
+* Internal projection kernels of the shproject library     *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#ifndef SH_KERNEL_H
+#define SH_KERNEL_H
+
+#include <string.h>
+
+#include "sh_project.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SH_KERNEL_X86
+#endif
+
+#define SH_TILE_ROWS 16 // sampled rows per parallel task
+
+// pixel formats of the projection and filter paths
+typedef enum sh__format
+{
+	SH__RGB8, // 3 unsigned chars per texel, 0..255 maps to 0..1
+	SH__RGBF  // 3 floats per texel, linear radiance
+} sh__format;
+
+static inline size_t sh__texel_size(sh__format format)
+{
+	return format == SH__RGBF ? 3 * sizeof(float) : 3;
+}
+
+// per face direction (+x, -x, ...) and texture x and y axes
+extern const m_vec3 sh__skyDir[SH_FACES];
+extern const m_vec3 sh__skyX[SH_FACES];
+extern const m_vec3 sh__skyY[SH_FACES];
+
+// precomputed per sample data of a face, shared by all six faces since
+// their texture axes only differ by sign and permutation.
+// the face local direction of sample (i, j) is (u[i], v[j], 1) * il[j * stride + i].
+typedef struct sh__table
+{
+	int w, h, step;
+	sh_weighting weighting;
+	int nx, ny;    // samples per row and sampled rows
+	int stride;    // floats per table row, nx padded to a multiple of 8
+	float *u;      // [stride], padding is 0
+	float *v;      // [ny]
+	float *il;     // [ny * stride] 1 / length of the unnormalized direction
+	float *weight; // [ny * stride] texel solid angle, padding is 0
+} sh__table;
+
+// returns the cached table for these parameters, building it on first use.
+// tables live until sh_free_tables() is called.
+const sh__table *sh__get_table(int w, int h, int step, sh_weighting weighting, int threads);
+
+// distance between the sampled rows of a tightly packed face
+static inline size_t sh__sampled_row_bytes(const sh__table *table, sh__format format)
+{
+	return (size_t)table->step * table->w * sh__texel_size(format);
+}
+
+// the same for equirectangular (lat-long) images. row j is at polar angle
+// theta (0 at the top, +y), column i at azimuth phi (0 in the image center, -z,
+// growing towards +x), so the direction is
+// (sinTheta[j] * sinPhi[i], cosTheta[j], -sinTheta[j] * cosPhi[i]).
+// the weight of sample (i, j) is colWeight[i] * rowWeight[j].
+typedef struct sh__latlong_table
+{
+	int w, h, step;
+	sh_weighting weighting;
+	int nx, ny;         // samples per row and sampled rows
+	int stride;         // nx padded to a multiple of 8
+	float *sinPhi;      // [stride], padding is 0
+	float *cosPhi;      // [stride], padding is 0
+	float *colWeight;   // [stride] azimuth extent of a sample, padding is 0
+	float *sinTheta;    // [ny]
+	float *cosTheta;    // [ny]
+	float *rowWeight;   // [ny]
+} sh__latlong_table;
+
+// cached like sh__get_table
+const sh__latlong_table *sh__get_latlong_table(int w, int h, int step, sh_weighting weighting);
+
+// adds the samples of the sampled rows [j0, j1) of a face to acc.
+// pixels points to the first texel of sampled row j0, the following sampled
+// rows are rowBytes apart (step * w texels in a whole face, less in a
+// streaming buffer). texels are 3 unsigned chars (rgb8, scaled by 1/255) or
+// 3 floats (rgbf) each.
+typedef void (*sh__rows)(sh_accum *acc, int face, const void *pixels, size_t rowBytes, const sh__table *table, int j0, int j1);
+
+void sh__project_rows_rgb8_scalar(sh_accum *acc, int face, const void *pixels, size_t rowBytes, const sh__table *table, int j0, int j1);
+void sh__project_rows_rgbf_scalar(sh_accum *acc, int face, const void *pixels, size_t rowBytes, const sh__table *table, int j0, int j1);
+
+// the same for the sampled rows [j0, j1) of a lat-long image
+typedef void (*sh__latlong_rows)(sh_accum *acc, const void *pixels, size_t rowBytes, const sh__latlong_table *table, int j0, int j1);
+
+void sh__project_latlong_rows_rgb8_scalar(sh_accum *acc, const void *pixels, size_t rowBytes, const sh__latlong_table *table, int j0, int j1);
+void sh__project_latlong_rows_rgbf_scalar(sh_accum *acc, const void *pixels, size_t rowBytes, const sh__latlong_table *table, int j0, int j1);
+#ifdef SH_KERNEL_X86
+void sh__project_rows_rgb8_sse2(sh_accum *acc, int face, const void *pixels, size_t rowBytes, const sh__table *table, int j0, int j1);
+void sh__project_rows_rgbf_sse2(sh_accum *acc, int face, const void *pixels, size_t rowBytes, const sh__table *table, int j0, int j1);
+void sh__project_rows_rgb8_avx2(sh_accum *acc, int face, const void *pixels, size_t rowBytes, const sh__table *table, int j0, int j1);
+void sh__project_rows_rgbf_avx2(sh_accum *acc, int face, const void *pixels, size_t rowBytes, const sh__table *table, int j0, int j1);
+void sh__project_latlong_rows_rgb8_sse2(sh_accum *acc, const void *pixels, size_t rowBytes, const sh__latlong_table *table, int j0, int j1);
+void sh__project_latlong_rows_rgbf_sse2(sh_accum *acc, const void *pixels, size_t rowBytes, const sh__latlong_table *table, int j0, int j1);
+void sh__project_latlong_rows_rgb8_avx2(sh_accum *acc, const void *pixels, size_t rowBytes, const sh__latlong_table *table, int j0, int j1);
+void sh__project_latlong_rows_rgbf_avx2(sh_accum *acc, const void *pixels, size_t rowBytes, const sh__latlong_table *table, int j0, int j1);
+#endif
+
+// evaluates the coefficients in the directions of the rows [j0, j1) of a
+// step 1 table into tightly packed rgb floats, out is the start of row j0
+typedef void (*sh__eval_rows)(const m_vec3 *coefficients, int face, const sh__table *table, int j0, int j1, float *out);
+typedef void (*sh__eval_latlong_rows)(const m_vec3 *coefficients, const sh__latlong_table *table, int j0, int j1, float *out);
+
+#ifdef SH_KERNEL_X86
+void sh__eval_rows_sse2(const m_vec3 *coefficients, int face, const sh__table *table, int j0, int j1, float *out);
+void sh__eval_rows_avx2(const m_vec3 *coefficients, int face, const sh__table *table, int j0, int j1, float *out);
+void sh__eval_latlong_rows_sse2(const m_vec3 *coefficients, const sh__latlong_table *table, int j0, int j1, float *out);
+void sh__eval_latlong_rows_avx2(const m_vec3 *coefficients, const sh__latlong_table *table, int j0, int j1, float *out);
+#endif
+
+// adds one sample of radiance light (already weighted) in direction n to the radiance SH
+static inline void sh__accumulate(sh_accum *acc, m_vec3 n, m_vec3 light)
+{
+	acc->coefficients[0] = m_add3(acc->coefficients[0], m_scale3(light, 0.282095f));
+	acc->coefficients[1] = m_add3(acc->coefficients[1], m_scale3(light, -0.488603f * n.y));
+	acc->coefficients[2] = m_add3(acc->coefficients[2], m_scale3(light, 0.488603f * n.z));
+	acc->coefficients[3] = m_add3(acc->coefficients[3], m_scale3(light, -0.488603f * n.x));
+	acc->coefficients[4] = m_add3(acc->coefficients[4], m_scale3(light, 1.092548f * n.x * n.y));
+	acc->coefficients[5] = m_add3(acc->coefficients[5], m_scale3(light, -1.092548f * n.y * n.z));
+	acc->coefficients[6] = m_add3(acc->coefficients[6], m_scale3(light, 0.315392f * (3.0f * n.z * n.z - 1.0f)));
+	acc->coefficients[7] = m_add3(acc->coefficients[7], m_scale3(light, -1.092548f * n.x * n.z));
+	acc->coefficients[8] = m_add3(acc->coefficients[8], m_scale3(light, 0.546274f * (n.x * n.x - n.y * n.y)));
+}
+
+// the radiance SH in direction n
+static inline m_vec3 sh__evaluate(const m_vec3 *c, m_vec3 n)
+{
+	m_vec3 r = m_scale3(c[0], 0.282095f);
+	r = m_add3(r, m_scale3(c[1], -0.488603f * n.y));
+	r = m_add3(r, m_scale3(c[2], 0.488603f * n.z));
+	r = m_add3(r, m_scale3(c[3], -0.488603f * n.x));
+	r = m_add3(r, m_scale3(c[4], 1.092548f * n.x * n.y));
+	r = m_add3(r, m_scale3(c[5], -1.092548f * n.y * n.z));
+	r = m_add3(r, m_scale3(c[6], 0.315392f * (3.0f * n.z * n.z - 1.0f)));
+	r = m_add3(r, m_scale3(c[7], -1.092548f * n.x * n.z));
+	return m_add3(r, m_scale3(c[8], 0.546274f * (n.x * n.x - n.y * n.y)));
+}
+
+// packed coefficient sets (sh_pack.cpp). SH_PACK_RATIO8 stores coefficient
+// k >= 1 of channel c as ratios[(k - 1) * 3 + c] * l0[c] * l0[3] / 127.
+typedef struct sh__ratio8
+{
+	unsigned short l0[4];   // half floats: rgb of coefficient 0 and the ratio scale
+	signed char ratios[24];
+} sh__ratio8;
+
+// exact, including denormals, inf and nan. the exponent is rebiased with
+// integer math, multiplying denormal floats would be very slow on x86.
+static inline float sh__half_to_float(unsigned short h)
+{
+	unsigned int expmant = h & 0x7fff, bits;
+	float f;
+	if (expmant < 0x400) // zero or denormal: mantissa * 2^-24
+	{
+		f = (float)expmant * 5.9604644775390625e-8f;
+		memcpy(&bits, &f, sizeof(f));
+	}
+	else
+		bits = (expmant << 13) + (112u << 23) + (expmant >= 0x7c00 ? 112u << 23 : 0u);
+	bits |= (unsigned int)(h & 0x8000) << 16;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+// unpacks count packed coefficient sets, every kernel gives the same floats
+typedef void (*sh__unpack)(const void *packed, int count, m_vec3 *coefficients);
+
+#ifdef SH_KERNEL_X86
+void sh__unpack_half_sse2(const void *packed, int count, m_vec3 *coefficients);
+void sh__unpack_half_avx2(const void *packed, int count, m_vec3 *coefficients);
+void sh__unpack_ratio8_sse2(const void *packed, int count, m_vec3 *coefficients);
+void sh__unpack_ratio8_avx2(const void *packed, int count, m_vec3 *coefficients);
+#endif
+
+// area filter for faces whose rows arrive one at a time (sh_filter.cpp),
+// giving the same texels as sh_downsample_face_*
+typedef struct sh__row_filter
+{
+	sh__format format;
+	int w, h, dw, dh;
+	int *xEdge;  // [dw + 1] first source column of every output column
+	void *sums;  // [dw * 3] sums of the output row in progress
+	void *row;   // the last finished output row
+	int y, j;    // next source row and output row in progress
+	int y1;      // first source row of the next output row
+} sh__row_filter;
+
+int sh__row_filter_init(sh__row_filter *filter, sh__format format, int w, int h, int dw, int dh);
+void sh__row_filter_free(sh__row_filter *filter);
+// adds the next source row, returns the output row it completes or 0
+const void *sh__row_filter_add(sh__row_filter *filter, const void *row);
+
+// projection of an image whose texel rows arrive one at a time from a
+// streaming decoder (sh_stream.cpp). SH_TILE_ROWS sampled rows are kept and
+// projected into their tile sum as soon as the tile is complete, so the
+// sums are bit-identical to the tiled projection of the whole image.
+typedef struct sh__stream sh__stream;
+typedef void (*sh__stream_tile)(sh__stream *stream, sh_accum *acc, const void *pixels, size_t rowBytes, int j0, int j1);
+
+struct sh__stream
+{
+	sh__format format;
+	int pw, ph, step, ny;   // projected size, sampling and sampled rows
+	sh__stream_tile project;
+	void *user;
+	int filtered;           // w x h is area filtered to pw x ph first
+	sh__row_filter filter;
+	int y;                  // next texel row of the projected image
+	size_t rowBytes;        // one texel row of the projected image
+	unsigned char *rows;    // [SH_TILE_ROWS] sampled rows
+	int buffered;
+	int tiles;
+	sh_accum *partials;     // [tiles], ownership may be taken by setting it to 0
+};
+
+int sh__stream_init(sh__stream *stream, sh__format format, int w, int h, int pw, int ph, int step, int ny, sh__stream_tile project, void *user);
+void sh__stream_row(sh__stream *stream, const void *row);
+void sh__stream_free(sh__stream *stream);
+
+// coefficient cache (sh_cache.cpp). the key covers the contents of the files
+// and every setting that changes the result. returns 0 on failure / miss.
+int sh__cache_key(const char **files, int count, const sh_settings *settings, sh__format format, int scaledDecode, unsigned long long *key);
+int sh__cache_load(const char *cacheFile, unsigned long long key, m_vec3 *coefficients);
+void sh__cache_store(const char *cacheFile, unsigned long long key, const m_vec3 *coefficients);
+
+// largest power of two reduction (up to 1/8) that the JPEG decoder can apply
+// to file while keeping at least minW x minH texels and an aligned texel grid
+int sh__decode_scale(const char *file, int minW, int minH);
+
+#endif
@@ -0,0 +1,98 @@
+/***********************************************************
+* AVX2 + FMA projection kernels (8 texels per iteration)   *
+* only called after a runtime CPUID check, so this is the  *
+* only file that is compiled with -mavx2 -mfma             *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include "sh_kernel.h"
+
+#ifdef SH_KERNEL_X86
+#include <immintrin.h>
+
+#define SHV                __m256
+#define SHV_LANES          8
+#define shv_set1(a)        _mm256_set1_ps(a)
+#define shv_load(p)        _mm256_load_ps(p)
+#define shv_loadu(p)       _mm256_loadu_ps(p)
+#define shv_store(p, a)    _mm256_store_ps(p, a)
+#define shv_add(a, b)      _mm256_add_ps(a, b)
+#define shv_sub(a, b)      _mm256_sub_ps(a, b)
+#define shv_mul(a, b)      _mm256_mul_ps(a, b)
+#define shv_madd(a, b, c)  _mm256_fmadd_ps(a, b, c)
+
+#define SH_KERNEL_NAME         sh__project_rows_rgb8_avx2
+#define SH_EVAL_KERNEL_NAME    sh__eval_rows_avx2
+#define SH_EVAL_LATLONG_KERNEL_NAME sh__eval_latlong_rows_avx2
+#define SH_LATLONG_KERNEL_NAME sh__project_latlong_rows_rgb8_avx2
+#define SH_GATHER_NAME         sh__gather_rgb8
+#define SH_PIXEL               unsigned char
+#define SH_PIXEL_SCALE         (1.0f / 255.0f)
+#include "sh_kernel_simd.inl"
+
+#define SH_KERNEL_NAME         sh__project_rows_rgbf_avx2
+#define SH_LATLONG_KERNEL_NAME sh__project_latlong_rows_rgbf_avx2
+#define SH_GATHER_NAME         sh__gather_rgbf
+#define SH_PIXEL               float
+#define SH_PIXEL_SCALE         1.0f
+#include "sh_kernel_simd.inl"
+
+// half floats zero extended to 32 bit lanes -> floats, like sh__half_to_float
+static inline __m256 sh__half8_to_float(__m256i h)
+{
+	const __m256i expmant = _mm256_and_si256(h, _mm256_set1_epi32(0x7fff));
+	const __m256i sign = _mm256_slli_epi32(_mm256_xor_si256(h, expmant), 16);
+	const __m256i infnan = _mm256_and_si256(_mm256_cmpgt_epi32(expmant, _mm256_set1_epi32(0x7bff)), _mm256_set1_epi32(112 << 23));
+	const __m256i normal = _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(expmant, 13), _mm256_set1_epi32(112 << 23)), infnan);
+	const __m256 denormal = _mm256_mul_ps(_mm256_cvtepi32_ps(expmant), _mm256_set1_ps(5.9604644775390625e-8f));
+	const __m256i isDenormal = _mm256_cmpgt_epi32(_mm256_set1_epi32(0x400), expmant);
+	const __m256 f = _mm256_blendv_ps(_mm256_castsi256_ps(normal), denormal, _mm256_castsi256_ps(isDenormal));
+	return _mm256_or_ps(f, _mm256_castsi256_ps(sign));
+}
+
+void sh__unpack_half_avx2(const void *packed, int count, m_vec3 *coefficients)
+{
+	const unsigned short *h = (const unsigned short*)packed;
+	float *c = &coefficients[0].x;
+	size_t n = (size_t)count * SH_COEFFICIENTS * 3, i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(h + i));
+		_mm256_storeu_ps(c + i, sh__half8_to_float(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(v))));
+		_mm256_storeu_ps(c + i + 8, sh__half8_to_float(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1))));
+	}
+	for (; i < n; i++)
+		c[i] = sh__half_to_float(h[i]);
+}
+
+void sh__unpack_ratio8_avx2(const void *packed, int count, m_vec3 *coefficients)
+{
+	const sh__ratio8 *p = (const sh__ratio8*)packed;
+	for (int i = 0; i < count; i++, p++)
+	{
+		float *c = &coefficients[(size_t)i * SH_COEFFICIENTS].x;
+		alignas(32) float l0[8];
+		_mm256_store_ps(l0, sh__half8_to_float(_mm256_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)p->l0))));
+		float k = l0[3] / 127.0f;
+		float r = l0[0] * k, g = l0[1] * k, b = l0[2] * k;
+		c[0] = l0[0]; c[1] = l0[1]; c[2] = l0[2];
+
+		// 8 lanes: the channel pattern shifts by 2 per vector
+		const __m256 s0 = _mm256_setr_ps(r, g, b, r, g, b, r, g);
+		const __m256 s1 = _mm256_setr_ps(b, r, g, b, r, g, b, r);
+		const __m256 s2 = _mm256_setr_ps(g, b, r, g, b, r, g, b);
+		for (int v = 0; v < 3; v++)
+		{
+			__m256 q = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(p->ratios + 8 * v))));
+			_mm256_storeu_ps(c + 3 + 8 * v, _mm256_mul_ps(q, v == 0 ? s0 : v == 1 ? s1 : s2));
+		}
+	}
+}
+#endif
@@ -0,0 +1,228 @@
+/***********************************************************
+* SoA projection kernel body, instantiated per instruction *
+* set by sh_kernel_sse2.cpp and sh_kernel_avx2.cpp         *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+// expects: SHV (vector type), SHV_LANES, shv_set1, shv_load, shv_loadu,
+// shv_store, shv_add, shv_sub, shv_mul, shv_madd (a * b + c), SH_KERNEL_NAME
+// (cubemap rows), SH_LATLONG_KERNEL_NAME (lat-long rows), SH_PIXEL (channel
+// type) and SH_PIXEL_SCALE (channel value to radiance). optionally
+// SH_EVAL_KERNEL_NAME and SH_EVAL_LATLONG_KERNEL_NAME (reconstruction rows,
+// they do not depend on the pixel type, so only define them once).
+// may be included several times per instruction set, the kernel names and
+// SH_PIXEL* are undefined at the end.
+
+#ifndef SH_KERNEL_SIMD_COMMON
+#define SH_KERNEL_SIMD_COMMON
+
+// the 9 basis functions for SHV_LANES directions
+static inline void sh__simd_basis(SHV *basis, SHV nx, SHV ny, SHV nz)
+{
+	const SHV k0 = shv_set1(0.282095f);
+	const SHV k1 = shv_set1(-0.488603f);
+	const SHV k2 = shv_set1(0.488603f);
+	const SHV k4 = shv_set1(1.092548f);
+	const SHV k5 = shv_set1(-1.092548f);
+	const SHV k6 = shv_set1(0.315392f);
+	const SHV k8 = shv_set1(0.546274f);
+	const SHV one = shv_set1(1.0f), three = shv_set1(3.0f);
+
+	basis[0] = k0;
+	basis[1] = shv_mul(k1, ny);
+	basis[2] = shv_mul(k2, nz);
+	basis[3] = shv_mul(k1, nx);
+	basis[4] = shv_mul(k4, shv_mul(nx, ny));
+	basis[5] = shv_mul(k5, shv_mul(ny, nz));
+	basis[6] = shv_mul(k6, shv_sub(shv_mul(three, shv_mul(nz, nz)), one));
+	basis[7] = shv_mul(k5, shv_mul(nx, nz));
+	basis[8] = shv_mul(k8, shv_sub(shv_mul(nx, nx), shv_mul(ny, ny)));
+}
+
+// sum[k * 3 + c] += light_c * basis_k(n) for SHV_LANES samples
+static inline void sh__simd_accumulate(SHV *sum, SHV nx, SHV ny, SHV nz, SHV R, SHV G, SHV B)
+{
+	SHV basis[SH_COEFFICIENTS];
+	sh__simd_basis(basis, nx, ny, nz);
+	for (int k = 0; k < SH_COEFFICIENTS; k++)
+	{
+		sum[k * 3 + 0] = shv_madd(R, basis[k], sum[k * 3 + 0]);
+		sum[k * 3 + 1] = shv_madd(G, basis[k], sum[k * 3 + 1]);
+		sum[k * 3 + 2] = shv_madd(B, basis[k], sum[k * 3 + 2]);
+	}
+}
+
+// horizontal reduction in lane order
+static inline void sh__simd_reduce(sh_accum *acc, const SHV *sum, SHV weightSum)
+{
+	alignas(32) float lanes[SHV_LANES];
+	float *c = &acc->coefficients[0].x;
+	for (int k = 0; k < SH_COEFFICIENTS * 3; k++)
+	{
+		shv_store(lanes, sum[k]);
+		for (int j = 0; j < SHV_LANES; j++)
+			c[k] += lanes[j];
+	}
+	shv_store(lanes, weightSum);
+	for (int j = 0; j < SHV_LANES; j++)
+		acc->weightSum += lanes[j];
+}
+
+// writes sum_k c[k * 3 + ch] * basis_k(n) of the first valid lanes to out as rgb
+static inline void sh__simd_evaluate(const SHV *c, SHV nx, SHV ny, SHV nz, int valid, float *out)
+{
+	alignas(32) float r[SHV_LANES], g[SHV_LANES], b[SHV_LANES];
+	SHV basis[SH_COEFFICIENTS];
+	sh__simd_basis(basis, nx, ny, nz);
+	SHV R = shv_mul(c[0], basis[0]), G = shv_mul(c[1], basis[0]), B = shv_mul(c[2], basis[0]);
+	for (int k = 1; k < SH_COEFFICIENTS; k++)
+	{
+		R = shv_madd(c[k * 3 + 0], basis[k], R);
+		G = shv_madd(c[k * 3 + 1], basis[k], G);
+		B = shv_madd(c[k * 3 + 2], basis[k], B);
+	}
+	shv_store(r, R);
+	shv_store(g, G);
+	shv_store(b, B);
+	for (int k = 0; k < valid; k++, out += 3)
+	{
+		out[0] = r[k]; out[1] = g[k]; out[2] = b[k];
+	}
+}
+
+#endif
+
+// gathers SHV_LANES rgb samples that are step texels apart, zeros past valid
+static inline void SH_GATHER_NAME(const SH_PIXEL *p, int step, int valid, float *r, float *g, float *b)
+{
+	for (int k = 0; k < valid; k++, p += step * 3)
+	{
+		r[k] = p[0]; g[k] = p[1]; b[k] = p[2];
+	}
+	for (int k = valid; k < SHV_LANES; k++)
+		r[k] = g[k] = b[k] = 0.0f;
+}
+
+void SH_KERNEL_NAME(sh_accum *acc, int face, const void *pixels, size_t rowBytes, const sh__table *table, int j0, int j1)
+{
+	alignas(32) float r[SHV_LANES], g[SHV_LANES], b[SHV_LANES];
+	const int samples = table->nx, step = table->step;
+	const m_vec3 X = sh__skyX[face], Y = sh__skyY[face], D = sh__skyDir[face];
+	const SHV Xx = shv_set1(X.x), Xy = shv_set1(X.y), Xz = shv_set1(X.z);
+	const SHV scale = shv_set1(SH_PIXEL_SCALE);
+
+	SHV sum[SH_COEFFICIENTS * 3], weightSum = shv_set1(0.0f);
+	for (int k = 0; k < SH_COEFFICIENTS * 3; k++)
+		sum[k] = shv_set1(0.0f);
+
+	for (int j = j0; j < j1; j++)
+	{
+		const SH_PIXEL *row = (const SH_PIXEL*)((const char*)pixels + (size_t)(j - j0) * rowBytes);
+		const float *il = table->il + (size_t)j * table->stride;
+		const float *weight = table->weight + (size_t)j * table->stride;
+		float v = table->v[j];
+		const SHV cx = shv_set1(Y.x * v + D.x), cy = shv_set1(Y.y * v + D.y), cz = shv_set1(Y.z * v + D.z);
+		for (int i = 0; i < samples; i += SHV_LANES) // the table rows are padded with zero weights
+		{
+			SH_GATHER_NAME(row + (size_t)i * step * 3, step, m_mini(SHV_LANES, samples - i), r, g, b);
+
+			SHV u = shv_loadu(table->u + i), l = shv_loadu(il + i), wt = shv_loadu(weight + i);
+			SHV nx = shv_mul(shv_madd(Xx, u, cx), l), ny = shv_mul(shv_madd(Xy, u, cy), l), nz = shv_mul(shv_madd(Xz, u, cz), l);
+
+			SHV s = shv_mul(wt, scale);
+			sh__simd_accumulate(sum, nx, ny, nz, shv_mul(shv_load(r), s), shv_mul(shv_load(g), s), shv_mul(shv_load(b), s));
+			weightSum = shv_add(weightSum, wt);
+		}
+	}
+	sh__simd_reduce(acc, sum, weightSum);
+}
+
+// same as above with the lat-long direction and weight tables
+void SH_LATLONG_KERNEL_NAME(sh_accum *acc, const void *pixels, size_t rowBytes, const sh__latlong_table *table, int j0, int j1)
+{
+	alignas(32) float r[SHV_LANES], g[SHV_LANES], b[SHV_LANES];
+	const int samples = table->nx, step = table->step;
+	const SHV scale = shv_set1(SH_PIXEL_SCALE);
+
+	SHV sum[SH_COEFFICIENTS * 3], weightSum = shv_set1(0.0f);
+	for (int k = 0; k < SH_COEFFICIENTS * 3; k++)
+		sum[k] = shv_set1(0.0f);
+
+	for (int j = j0; j < j1; j++)
+	{
+		const SH_PIXEL *row = (const SH_PIXEL*)((const char*)pixels + (size_t)(j - j0) * rowBytes);
+		const SHV st = shv_set1(table->sinTheta[j]), nst = shv_set1(-table->sinTheta[j]);
+		const SHV ny = shv_set1(table->cosTheta[j]), rowWeight = shv_set1(table->rowWeight[j]);
+		for (int i = 0; i < samples; i += SHV_LANES) // colWeight is 0 in the padding
+		{
+			SH_GATHER_NAME(row + (size_t)i * step * 3, step, m_mini(SHV_LANES, samples - i), r, g, b);
+
+			SHV nx = shv_mul(st, shv_loadu(table->sinPhi + i)), nz = shv_mul(nst, shv_loadu(table->cosPhi + i));
+			SHV wt = shv_mul(rowWeight, shv_loadu(table->colWeight + i));
+
+			SHV s = shv_mul(wt, scale);
+			sh__simd_accumulate(sum, nx, ny, nz, shv_mul(shv_load(r), s), shv_mul(shv_load(g), s), shv_mul(shv_load(b), s));
+			weightSum = shv_add(weightSum, wt);
+		}
+	}
+	sh__simd_reduce(acc, sum, weightSum);
+}
+
+#ifdef SH_EVAL_KERNEL_NAME
+void SH_EVAL_KERNEL_NAME(const m_vec3 *coefficients, int face, const sh__table *table, int j0, int j1, float *out)
+{
+	const int samples = table->nx;
+	const m_vec3 X = sh__skyX[face], Y = sh__skyY[face], D = sh__skyDir[face];
+	const SHV Xx = shv_set1(X.x), Xy = shv_set1(X.y), Xz = shv_set1(X.z);
+	SHV c[SH_COEFFICIENTS * 3];
+	for (int k = 0; k < SH_COEFFICIENTS * 3; k++)
+		c[k] = shv_set1((&coefficients[0].x)[k]);
+
+	for (int j = j0; j < j1; j++, out += 3 * samples)
+	{
+		const float *il = table->il + (size_t)j * table->stride;
+		float v = table->v[j];
+		const SHV cx = shv_set1(Y.x * v + D.x), cy = shv_set1(Y.y * v + D.y), cz = shv_set1(Y.z * v + D.z);
+		for (int i = 0; i < samples; i += SHV_LANES)
+		{
+			SHV u = shv_loadu(table->u + i), l = shv_loadu(il + i);
+			SHV nx = shv_mul(shv_madd(Xx, u, cx), l), ny = shv_mul(shv_madd(Xy, u, cy), l), nz = shv_mul(shv_madd(Xz, u, cz), l);
+			sh__simd_evaluate(c, nx, ny, nz, m_mini(SHV_LANES, samples - i), out + 3 * i);
+		}
+	}
+}
+
+void SH_EVAL_LATLONG_KERNEL_NAME(const m_vec3 *coefficients, const sh__latlong_table *table, int j0, int j1, float *out)
+{
+	const int samples = table->nx;
+	SHV c[SH_COEFFICIENTS * 3];
+	for (int k = 0; k < SH_COEFFICIENTS * 3; k++)
+		c[k] = shv_set1((&coefficients[0].x)[k]);
+
+	for (int j = j0; j < j1; j++, out += 3 * samples)
+	{
+		const SHV st = shv_set1(table->sinTheta[j]), nst = shv_set1(-table->sinTheta[j]);
+		const SHV ny = shv_set1(table->cosTheta[j]);
+		for (int i = 0; i < samples; i += SHV_LANES)
+		{
+			SHV nx = shv_mul(st, shv_loadu(table->sinPhi + i)), nz = shv_mul(nst, shv_loadu(table->cosPhi + i));
+			sh__simd_evaluate(c, nx, ny, nz, m_mini(SHV_LANES, samples - i), out + 3 * i);
+		}
+	}
+}
+#endif
+
+#undef SH_EVAL_KERNEL_NAME
+#undef SH_EVAL_LATLONG_KERNEL_NAME
+#undef SH_KERNEL_NAME
+#undef SH_LATLONG_KERNEL_NAME
+#undef SH_GATHER_NAME
+#undef SH_PIXEL
+#undef SH_PIXEL_SCALE
@@ -0,0 +1,105 @@
+/***********************************************************
+* SSE2 projection kernels (4 texels per iteration)         *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include "sh_kernel.h"
+
+#ifdef SH_KERNEL_X86
+#include <emmintrin.h>
+
+#define SHV                __m128
+#define SHV_LANES          4
+#define shv_set1(a)        _mm_set1_ps(a)
+#define shv_load(p)        _mm_load_ps(p)
+#define shv_loadu(p)       _mm_loadu_ps(p)
+#define shv_store(p, a)    _mm_store_ps(p, a)
+#define shv_add(a, b)      _mm_add_ps(a, b)
+#define shv_sub(a, b)      _mm_sub_ps(a, b)
+#define shv_mul(a, b)      _mm_mul_ps(a, b)
+#define shv_madd(a, b, c)  _mm_add_ps(_mm_mul_ps(a, b), c)
+
+#define SH_KERNEL_NAME         sh__project_rows_rgb8_sse2
+#define SH_EVAL_KERNEL_NAME    sh__eval_rows_sse2
+#define SH_EVAL_LATLONG_KERNEL_NAME sh__eval_latlong_rows_sse2
+#define SH_LATLONG_KERNEL_NAME sh__project_latlong_rows_rgb8_sse2
+#define SH_GATHER_NAME         sh__gather_rgb8
+#define SH_PIXEL               unsigned char
+#define SH_PIXEL_SCALE         (1.0f / 255.0f)
+#include "sh_kernel_simd.inl"
+
+#define SH_KERNEL_NAME         sh__project_rows_rgbf_sse2
+#define SH_LATLONG_KERNEL_NAME sh__project_latlong_rows_rgbf_sse2
+#define SH_GATHER_NAME         sh__gather_rgbf
+#define SH_PIXEL               float
+#define SH_PIXEL_SCALE         1.0f
+#include "sh_kernel_simd.inl"
+
+// half floats zero extended to 32 bit lanes -> floats, like sh__half_to_float
+static inline __m128 sh__half4_to_float(__m128i h)
+{
+	const __m128i expmant = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+	const __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, expmant), 16);
+	const __m128i infnan = _mm_and_si128(_mm_cmpgt_epi32(expmant, _mm_set1_epi32(0x7bff)), _mm_set1_epi32(112 << 23));
+	const __m128i normal = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(expmant, 13), _mm_set1_epi32(112 << 23)), infnan);
+	const __m128 denormal = _mm_mul_ps(_mm_cvtepi32_ps(expmant), _mm_set1_ps(5.9604644775390625e-8f));
+	const __m128 isDenormal = _mm_castsi128_ps(_mm_cmplt_epi32(expmant, _mm_set1_epi32(0x400)));
+	const __m128 f = _mm_or_ps(_mm_and_ps(isDenormal, denormal), _mm_andnot_ps(isDenormal, _mm_castsi128_ps(normal)));
+	return _mm_or_ps(f, _mm_castsi128_ps(sign));
+}
+
+void sh__unpack_half_sse2(const void *packed, int count, m_vec3 *coefficients)
+{
+	const unsigned short *h = (const unsigned short*)packed;
+	float *c = &coefficients[0].x;
+	size_t n = (size_t)count * SH_COEFFICIENTS * 3, i = 0;
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 8 <= n; i += 8)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(h + i));
+		_mm_storeu_ps(c + i, sh__half4_to_float(_mm_unpacklo_epi16(v, zero)));
+		_mm_storeu_ps(c + i + 4, sh__half4_to_float(_mm_unpackhi_epi16(v, zero)));
+	}
+	for (; i < n; i++)
+		c[i] = sh__half_to_float(h[i]);
+}
+
+// 8 signed bytes -> 16 bit, then 4 of them -> 32 bit floats
+#define SH__INT8_TO_INT16_LO(v)  _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8)
+#define SH__INT8_TO_INT16_HI(v)  _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8)
+#define SH__INT16_TO_FLOAT_LO(v) _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16))
+#define SH__INT16_TO_FLOAT_HI(v) _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16))
+
+void sh__unpack_ratio8_sse2(const void *packed, int count, m_vec3 *coefficients)
+{
+	const sh__ratio8 *p = (const sh__ratio8*)packed;
+	const __m128i zero = _mm_setzero_si128();
+	for (int i = 0; i < count; i++, p++)
+	{
+		float *c = &coefficients[(size_t)i * SH_COEFFICIENTS].x;
+		alignas(16) float l0[4];
+		_mm_store_ps(l0, sh__half4_to_float(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)p->l0), zero)));
+		float k = l0[3] / 127.0f;
+		float r = l0[0] * k, g = l0[1] * k, b = l0[2] * k;
+		c[0] = l0[0]; c[1] = l0[1]; c[2] = l0[2];
+
+		// the channel pattern repeats every 3 vectors
+		const __m128 s0 = _mm_setr_ps(r, g, b, r), s1 = _mm_setr_ps(g, b, r, g), s2 = _mm_setr_ps(b, r, g, b);
+		__m128i q = _mm_loadu_si128((const __m128i*)p->ratios), q16 = _mm_loadl_epi64((const __m128i*)(p->ratios + 16));
+		__m128i a = SH__INT8_TO_INT16_LO(q), d = SH__INT8_TO_INT16_HI(q), e = SH__INT8_TO_INT16_LO(q16);
+		_mm_storeu_ps(c + 3,  _mm_mul_ps(SH__INT16_TO_FLOAT_LO(a), s0));
+		_mm_storeu_ps(c + 7,  _mm_mul_ps(SH__INT16_TO_FLOAT_HI(a), s1));
+		_mm_storeu_ps(c + 11, _mm_mul_ps(SH__INT16_TO_FLOAT_LO(d), s2));
+		_mm_storeu_ps(c + 15, _mm_mul_ps(SH__INT16_TO_FLOAT_HI(d), s0));
+		_mm_storeu_ps(c + 19, _mm_mul_ps(SH__INT16_TO_FLOAT_LO(e), s1));
+		_mm_storeu_ps(c + 23, _mm_mul_ps(SH__INT16_TO_FLOAT_HI(e), s2));
+	}
+}
+#endif
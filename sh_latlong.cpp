@@ -0,0 +1,247 @@
+/***********************************************************
+* Spherical harmonics projection of equirectangular        *
+* (lat-long) environment maps                              *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stb_image.h"
+
+#include "sh_project.h"
+#include "sh_kernel.h"
+#include "sh_pool.h"
+
+static sh__latlong_rows sh__select_latlong_rows(sh_kernel kernel, sh__format format)
+{
+	int f = format == SH__RGBF;
+#ifdef SH_KERNEL_X86
+	if ((kernel == SH_KERNEL_AUTO || kernel == SH_KERNEL_AVX2) && sh_kernel_supported(SH_KERNEL_AVX2))
+		return f ? sh__project_latlong_rows_rgbf_avx2 : sh__project_latlong_rows_rgb8_avx2;
+	if (kernel != SH_KERNEL_SCALAR)
+		return f ? sh__project_latlong_rows_rgbf_sse2 : sh__project_latlong_rows_rgb8_sse2;
+#endif
+	return f ? sh__project_latlong_rows_rgbf_scalar : sh__project_latlong_rows_rgb8_scalar;
+}
+
+template <typename T>
+static void sh__project_latlong_rows_scalar(sh_accum *acc, const void *pixels, size_t rowBytes, const sh__latlong_table *table, int j0, int j1, float scale)
+{
+	for (int j = j0; j < j1; j++)
+	{
+		const T *p = (const T*)((const char*)pixels + (size_t)(j - j0) * rowBytes);
+		float st = table->sinTheta[j], ct = table->cosTheta[j];
+		for (int i = 0; i < table->nx; i++)
+		{
+			m_vec3 n = m_v3(st * table->sinPhi[i], ct, -st * table->cosPhi[i]);
+			float weight = table->colWeight[i] * table->rowWeight[j];
+			sh__accumulate(acc, n, m_scale3(m_v3(p[0], p[1], p[2]), weight * scale));
+			p += 3 * table->step;
+			acc->weightSum += weight;
+		}
+	}
+}
+
+void sh__project_latlong_rows_rgb8_scalar(sh_accum *acc, const void *pixels, size_t rowBytes, const sh__latlong_table *table, int j0, int j1)
+{
+	sh__project_latlong_rows_scalar<unsigned char>(acc, pixels, rowBytes, table, j0, j1, 1.0f / 255.0f);
+}
+
+void sh__project_latlong_rows_rgbf_scalar(sh_accum *acc, const void *pixels, size_t rowBytes, const sh__latlong_table *table, int j0, int j1)
+{
+	sh__project_latlong_rows_scalar<float>(acc, pixels, rowBytes, table, j0, j1, 1.0f);
+}
+
+typedef struct sh__latlong_tiles
+{
+	const void *pixels;
+	const sh__latlong_table *table;
+	size_t rowBytes;
+	sh__latlong_rows rows;
+	sh_accum *partials; // one per tile
+} sh__latlong_tiles;
+
+static void sh__project_latlong_tile(void *user, int index)
+{
+	sh__latlong_tiles *tiles = (sh__latlong_tiles*)user;
+	int j0 = index * SH_TILE_ROWS;
+	int j1 = m_mini(j0 + SH_TILE_ROWS, tiles->table->ny);
+	sh_accum_init(&tiles->partials[index]);
+	tiles->rows(&tiles->partials[index], (const char*)tiles->pixels + (size_t)j0 * tiles->rowBytes, tiles->rowBytes, tiles->table, j0, j1);
+}
+
+static int sh__project_latlong(const void *pixels, sh__format format, int w, int h, const sh_settings *settings, m_vec3 *coefficients)
+{
+	if (w < 2 || h < 2 || settings->step < 1)
+		return 0;
+	if (settings->resolution > 0)
+	{
+		// a cubemap face of n x n texels covers 90 degrees, so 4n x 2n keeps
+		// roughly the same angular resolution
+		sh_settings full = *settings;
+		full.step = 1;
+		full.resolution = 0;
+		int dw = m_mini(4 * settings->resolution, w), dh = m_mini(2 * settings->resolution, h);
+		if (dw == w && dh == h)
+			return sh__project_latlong(pixels, format, w, h, &full, coefficients);
+		void *small = malloc((size_t)dw * dh * sh__texel_size(format));
+		int result = small && dw >= 2 && dh >= 2;
+		if (result && format == SH__RGBF)
+			result = sh_downsample_face_rgbf((const float*)pixels, w, h, dw, dh, settings->threads, (float*)small);
+		else if (result)
+			result = sh_downsample_face_rgb8((const unsigned char*)pixels, w, h, dw, dh, settings->threads, (unsigned char*)small);
+		if (result)
+			result = sh__project_latlong(small, format, dw, dh, &full, coefficients);
+		free(small);
+		return result;
+	}
+
+	// same deterministic tiling and reduction as sh__project_cubemap
+	sh__latlong_tiles tiles;
+	tiles.pixels = pixels;
+	tiles.table = sh__get_latlong_table(w, h, settings->step, settings->weighting);
+	if (!tiles.table)
+		return 0;
+	tiles.rowBytes = (size_t)tiles.table->step * w * sh__texel_size(format);
+	tiles.rows = sh__select_latlong_rows(settings->kernel, format);
+	int count = (tiles.table->ny + SH_TILE_ROWS - 1) / SH_TILE_ROWS;
+	tiles.partials = (sh_accum*)malloc(count * sizeof(sh_accum));
+	if (!tiles.partials)
+		return 0;
+
+	sh_parallel_for(count, settings->threads, sh__project_latlong_tile, &tiles);
+
+	sh_accum acc;
+	sh_accum_init(&acc);
+	for (int i = 0; i < count; i++)
+		sh_accum_add(&acc, &tiles.partials[i]);
+	free(tiles.partials);
+	sh_accum_finish(&acc, coefficients);
+	return 1;
+}
+
+int sh_project_latlong_rgb8(const unsigned char *rgb, int w, int h, const sh_settings *settings, m_vec3 *coefficients)
+{
+	return sh__project_latlong(rgb, SH__RGB8, w, h, settings, coefficients);
+}
+
+int sh_project_latlong_rgbf(const float *rgb, int w, int h, const sh_settings *settings, m_vec3 *coefficients)
+{
+	return sh__project_latlong(rgb, SH__RGBF, w, h, settings, coefficients);
+}
+
+// row by row projection while the image is decoded (settings->stream)
+typedef struct sh__latlong_stream
+{
+	const sh_settings *settings;
+	sh__format format;
+	const sh__latlong_table *table;
+	sh__latlong_rows rows;
+	sh__stream stream;
+	int started, failed;
+} sh__latlong_stream;
+
+static void sh__latlong_stream_tile(sh__stream *stream, sh_accum *acc, const void *pixels, size_t rowBytes, int j0, int j1)
+{
+	sh__latlong_stream *s = (sh__latlong_stream*)stream->user;
+	s->rows(acc, pixels, rowBytes, s->table, j0, j1);
+}
+
+static void sh__latlong_stream_row(void *user, const void *row, int y, int w, int h)
+{
+	sh__latlong_stream *s = (sh__latlong_stream*)user;
+	if (y == 0)
+	{
+		// same sizes as sh__project_latlong
+		int pw = w, ph = h, step = s->settings->step;
+		if (s->settings->resolution > 0)
+		{
+			pw = m_mini(4 * s->settings->resolution, w);
+			ph = m_mini(2 * s->settings->resolution, h);
+			step = 1;
+		}
+		s->table = pw >= 2 && ph >= 2 ? sh__get_latlong_table(pw, ph, step, s->settings->weighting) : 0;
+		s->rows = sh__select_latlong_rows(s->settings->kernel, s->format);
+		s->failed = !s->table || !sh__stream_init(&s->stream, s->format, w, h, pw, ph, step, s->table->ny, sh__latlong_stream_tile, s);
+		s->started = 1;
+	}
+	if (!s->failed)
+		sh__stream_row(&s->stream, row);
+}
+
+static int sh__project_latlong_streamed(const char *file, sh__format format, int scale, const sh_settings *settings, m_vec3 *coefficients)
+{
+	sh__latlong_stream s;
+	memset(&s, 0, sizeof(s));
+	s.settings = settings;
+	s.format = format;
+	int w, h, c, ok;
+	if (format == SH__RGBF)
+		ok = stbi_loadf_rows(file, &w, &h, &c, 3, sh__latlong_stream_row, &s);
+	else
+		ok = stbi_load_rows(file, &w, &h, &c, 3, scale, sh__latlong_stream_row, &s);
+	int result = ok && s.started && !s.failed;
+	if (!ok)
+		fprintf(stderr, "Error loading %s\n", file);
+	else if (!result)
+		fprintf(stderr, "Error projecting %s\n", file);
+	else
+	{
+		sh_accum acc;
+		sh_accum_init(&acc);
+		for (int i = 0; i < s.stream.tiles; i++)
+			sh_accum_add(&acc, &s.stream.partials[i]);
+		sh_accum_finish(&acc, coefficients);
+	}
+	sh__stream_free(&s.stream);
+	return result;
+}
+
+static int sh__project_latlong_decoded(const char *file, sh__format format, int scale, const sh_settings *settings, m_vec3 *coefficients)
+{
+	int w, h, c;
+	void *pixels;
+	if (format == SH__RGBF)
+		pixels = stbi_loadf(file, &w, &h, &c, 3);
+	else
+		pixels = stbi_load_scaled(file, &w, &h, &c, 3, scale);
+	if (!pixels)
+	{
+		fprintf(stderr, "Error loading %s\n", file);
+		return 0;
+	}
+	int result = sh__project_latlong(pixels, format, w, h, settings, coefficients);
+	stbi_image_free(pixels);
+	if (!result)
+		fprintf(stderr, "Error projecting %s\n", file);
+	return result;
+}
+
+int sh_project_latlong_file(const char *file, const sh_settings *settings, m_vec3 *coefficients)
+{
+	if (settings->step < 1)
+		return 0;
+	sh__format format = sh_is_hdr_file(file) ? SH__RGBF : SH__RGB8;
+	int scale = format == SH__RGB8 && settings->resolution > 0 ? sh__decode_scale(file, 4 * settings->resolution, 2 * settings->resolution) : 0;
+
+	unsigned long long key = 0;
+	int cached = settings->cacheFile && sh__cache_key(&file, 1, settings, format, format == SH__RGB8 && settings->resolution > 0, &key);
+	if (cached && sh__cache_load(settings->cacheFile, key, coefficients))
+		return 1;
+
+	int result = settings->stream ?
+		sh__project_latlong_streamed(file, format, scale, settings, coefficients) :
+		sh__project_latlong_decoded(file, format, scale, settings, coefficients);
+	if (result && cached)
+		sh__cache_store(settings->cacheFile, key, coefficients);
+	return result;
+}
@@ -0,0 +1,394 @@
+/***********************************************************
+* Arbitrary order spherical harmonics (bands 0..L, L <= 8) *
+* with compile time basis constants. C++14 only.           *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#ifndef SH_ORDER_H
+#define SH_ORDER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <utility>
+
+#include "sh_project.h"
+#include "sh_kernel.h"
+#include "sh_pool.h"
+
+// real spherical harmonics in the same convention as the 9 coefficient
+// code (Condon-Shortley phase, index l * (l + 1) + m):
+//   Y_l^0  = K_l^0 Q_l^0(z)
+//   Y_l^m  = sqrt(2) K_l^m Q_l^m(z) Re((x + iy)^m)
+//   Y_l^-m = sqrt(2) K_l^m Q_l^m(z) Im((x + iy)^m)
+// where Q_l^m(z) = P_l^m(z) / sin(theta)^m is a polynomial in z, so the
+// basis needs no trigonometry. all constants are folded at compile time.
+
+#define SH_MAX_ORDER 8
+
+constexpr double sh__sqrt(double a)
+{
+	double x = a > 1.0 ? a : 1.0;
+	for (int i = 0; i < 64; i++)
+		x = 0.5 * (x + a / x);
+	return x;
+}
+
+constexpr double sh__pi = 3.14159265358979323846;
+
+// sqrt(2) K_l^m (or K_l^0 for m == 0)
+constexpr double sh__normalization(int l, int m)
+{
+	double ratio = 1.0; // (l - m)! / (l + m)!
+	for (int i = l - m + 1; i <= l + m; i++)
+		ratio /= i;
+	double k = sh__sqrt((2.0 * l + 1.0) / (4.0 * sh__pi) * ratio);
+	return m == 0 ? k : sh__sqrt(2.0) * k;
+}
+
+// Q_m^m = (-1)^m (2m - 1)!!
+constexpr double sh__qmm(int m)
+{
+	double q = 1.0;
+	for (int i = 1; i <= m; i++)
+		q *= -(2.0 * i - 1.0);
+	return q;
+}
+
+// Q_l^m = a z Q_(l-1)^m - b Q_(l-2)^m
+constexpr double sh__qa(int l, int m) { return (2.0 * l - 1.0) / (l - m); }
+constexpr double sh__qb(int l, int m) { return (l + m - 1.0) / (l - m); }
+
+// compile time loop, calls f(std::integral_constant<int, i>) for i = 0..N-1
+template <int N> struct sh__unroll
+{
+	template <typename F> static inline void run(F &f)
+	{
+		sh__unroll<N - 1>::run(f);
+		f(std::integral_constant<int, N - 1>());
+	}
+};
+template <> struct sh__unroll<0>
+{
+	template <typename F> static inline void run(F &) {}
+};
+
+// Q_l^m are visited m major, so the recurrence only looks back
+constexpr int sh__pair_m(int t)
+{
+	int m = 0;
+	for (int n = SH_MAX_ORDER + 1; t >= n; n--, m++)
+		t -= n;
+	return m;
+}
+constexpr int sh__pair_l(int t)
+{
+	int m = 0;
+	for (int n = SH_MAX_ORDER + 1; t >= n; n--, m++)
+		t -= n;
+	return m + t;
+}
+
+// Ivanic-Ruedenberg recurrence for the rotation matrix of band l from band
+// l - 1 and band 1 (J. Phys. Chem. 1996 / 1998 errata). matrices are indexed
+// [m + l][n + l] and use real harmonics without the Condon-Shortley phase.
+static inline float sh__rotation_p(int i, int a, int b, int l, const float *r1, const float *prev)
+{
+	int w1 = 3, wp = 2 * l - 1;
+	if (b == l)
+		return r1[(i + 1) * w1 + 2] * prev[(a + l - 1) * wp + 2 * l - 2] - r1[(i + 1) * w1 + 0] * prev[(a + l - 1) * wp + 0];
+	if (b == -l)
+		return r1[(i + 1) * w1 + 2] * prev[(a + l - 1) * wp + 0] + r1[(i + 1) * w1 + 0] * prev[(a + l - 1) * wp + 2 * l - 2];
+	return r1[(i + 1) * w1 + 1] * prev[(a + l - 1) * wp + b + l - 1];
+}
+
+static inline void sh__rotation_band(int l, const float *r1, const float *prev, float *out)
+{
+	int w = 2 * l + 1;
+	for (int m = -l; m <= l; m++)
+	{
+		for (int n = -l; n <= l; n++)
+		{
+			int d = m == 0, am = m < 0 ? -m : m, an = n < 0 ? -n : n;
+			double denom = an == l ? 2.0 * l * (2.0 * l - 1.0) : (double)(l + n) * (l - n);
+			double u = sqrt((l + m) * (l - m) / denom);
+			double v = 0.5 * sqrt((1.0 + d) * (l + am - 1.0) * (l + am) / denom) * (1.0 - 2.0 * d);
+			double wc = -0.5 * sqrt((l - am - 1.0) * (l - am) / denom) * (1.0 - d);
+			double r = 0.0;
+			if (u != 0.0)
+				r += u * sh__rotation_p(0, m, n, l, r1, prev);
+			if (v != 0.0)
+			{
+				double V;
+				if (m == 0)
+					V = sh__rotation_p(1, 1, n, l, r1, prev) + sh__rotation_p(-1, -1, n, l, r1, prev);
+				else if (m > 0)
+					V = sh__rotation_p(1, m - 1, n, l, r1, prev) * sqrt(1.0 + (m == 1)) - sh__rotation_p(-1, -m + 1, n, l, r1, prev) * (m != 1);
+				else
+					V = sh__rotation_p(1, m + 1, n, l, r1, prev) * (m != -1) + sh__rotation_p(-1, -m - 1, n, l, r1, prev) * sqrt(1.0 + (m == -1));
+				r += v * V;
+			}
+			if (wc != 0.0)
+			{
+				double W = m > 0 ?
+					sh__rotation_p(1, m + 1, n, l, r1, prev) + sh__rotation_p(-1, -m - 1, n, l, r1, prev) :
+					sh__rotation_p(1, m - 1, n, l, r1, prev) - sh__rotation_p(-1, -m + 1, n, l, r1, prev);
+				r += wc * W;
+			}
+			out[(m + l) * w + n + l] = (float)r;
+		}
+	}
+}
+
+template <int L>
+struct sh_order
+{
+	static_assert(L >= 0 && L <= SH_MAX_ORDER, "unsupported SH order");
+	static constexpr int bands = L + 1;
+	static constexpr int count = (L + 1) * (L + 1);
+
+	// out[count] = basis functions at the unit direction (x, y, z)
+	static inline void basis(float x, float y, float z, float *out)
+	{
+		float C[L + 1], S[L + 1];
+		C[0] = 1.0f; S[0] = 0.0f;
+		auto cs = [&](auto I)
+		{
+			constexpr int m = decltype(I)::value + 1;
+			C[m] = x * C[m - 1] - y * S[m - 1];
+			S[m] = x * S[m - 1] + y * C[m - 1];
+		};
+		sh__unroll<L>::run(cs);
+
+		float Q[SH_MAX_ORDER + 1][SH_MAX_ORDER + 1];
+		auto q = [&](auto I)
+		{
+			constexpr int t = decltype(I)::value;
+			constexpr int l = sh__pair_l(t), m = sh__pair_m(t);
+			if (l > L) return;
+			if (l == m)
+				Q[l][m] = (float)sh__qmm(m);
+			else if (l == m + 1)
+				Q[l][m] = (float)(2.0 * m + 1.0) * z * Q[m][m];
+			else
+				Q[l][m] = (float)sh__qa(l, m) * z * Q[l - 1][m] - (float)sh__qb(l, m) * Q[l > 1 ? l - 2 : 0][m];
+
+			constexpr float k = (float)sh__normalization(l, m);
+			if (m == 0)
+				out[l * (l + 1)] = k * Q[l][0];
+			else
+			{
+				out[l * (l + 1) + m] = k * Q[l][m] * C[m];
+				out[l * (l + 1) - m] = k * Q[l][m] * S[m];
+			}
+		};
+		sh__unroll<(SH_MAX_ORDER + 1) * (SH_MAX_ORDER + 2) / 2>::run(q);
+	}
+
+	static inline m_vec3 evaluate(const m_vec3 *coefficients, m_vec3 n)
+	{
+		float Y[count];
+		basis(n.x, n.y, n.z, Y);
+		m_vec3 result = m_v3(0.0f, 0.0f, 0.0f);
+		for (int i = 0; i < count; i++)
+			result = m_add3(result, m_scale3(coefficients[i], Y[i]));
+		return result;
+	}
+
+	// multiplies every coefficient of band l by factors[l]
+	static inline void convolve(m_vec3 *coefficients, const float *factors)
+	{
+		for (int l = 0; l <= L; l++)
+			for (int m = -l; m <= l; m++)
+				coefficients[l * (l + 1) + m] = m_scale3(coefficients[l * (l + 1) + m], factors[l]);
+	}
+
+	// zonal harmonic kernels per band (see sh_project.h), for convolve()
+	static inline void lambert(float *factors) { sh_lambert_factors(bands, factors); }
+	static inline void phong(float exponent, float *factors) { sh_phong_factors(bands, exponent, factors); }
+	static inline void gaussian(float width, float *factors) { sh_gaussian_factors(bands, width, factors); }
+
+	// floats of the block diagonal rotation matrix, (2l + 1)^2 per band
+	static constexpr int rotationSize = (L + 1) * (2 * L + 1) * (2 * L + 3) / 3;
+
+	// rotation matrix for sh_order<L>::rotate, built once per rotation q and
+	// shared by any number of coefficient sets. bands 1 and 2 come from the
+	// closed form of sh_rotation_init, higher bands from the recurrence.
+	static inline void rotation(m_quat q, float *matrix)
+	{
+		matrix[0] = 1.0f;
+		if (L < 1)
+			return;
+		sh_rotation r;
+		sh_rotation_init(&r, q);
+		float *band = matrix + 1;
+		memcpy(band, r.band1, sizeof(r.band1));
+		if (L < 2)
+			return;
+		band += 9;
+		memcpy(band, r.band2, sizeof(r.band2));
+
+		// the recurrence works without the Condon-Shortley phase, which
+		// flips the sign of odd |m|: entry (m, n) flips with m + n.
+		float r1[9], prev[(2 * SH_MAX_ORDER + 1) * (2 * SH_MAX_ORDER + 1)], next[(2 * SH_MAX_ORDER + 1) * (2 * SH_MAX_ORDER + 1)];
+		for (int i = 0; i < 9; i++)
+			r1[i] = (i / 3 + i % 3) & 1 ? -matrix[1 + i] : matrix[1 + i];
+		for (int i = 0; i < 25; i++)
+			prev[i] = (i / 5 + i % 5) & 1 ? -band[i] : band[i];
+		for (int l = 3; l <= L; l++)
+		{
+			int w = 2 * l + 1;
+			band += (w - 2) * (w - 2);
+			sh__rotation_band(l, r1, prev, next);
+			for (int i = 0; i < w * w; i++)
+			{
+				band[i] = (i / w + i % w) & 1 ? -next[i] : next[i];
+				prev[i] = next[i];
+			}
+		}
+	}
+
+	// out = matrix * in per band, in may be equal to out. O(count * (2L + 1)).
+	static inline void rotate(const float *matrix, const m_vec3 *in, m_vec3 *out)
+	{
+		m_vec3 r[count];
+		const float *m = matrix;
+		for (int l = 0; l <= L; l++)
+		{
+			int w = 2 * l + 1, base = l * l;
+			for (int i = 0; i < w; i++, m += w)
+			{
+				m_vec3 sum = m_v3(0.0f, 0.0f, 0.0f);
+				for (int j = 0; j < w; j++)
+					sum = m_add3(sum, m_scale3(in[base + j], m[j]));
+				r[base + i] = sum;
+			}
+		}
+		memcpy(out, r, sizeof(r));
+	}
+
+	// radiance projection of a cubemap using the cached sample tables.
+	// tiles and reduction order follow sh_project_cubemap_rgb8, so the result
+	// does not depend on the thread count either.
+	static int project(const unsigned char **faces, int w, int h, const sh_settings *settings, m_vec3 *coefficients)
+	{
+		if (w < 2 || h < 2 || settings->step < 1)
+			return 0;
+		const sh__table *table = sh__get_table(w, h, settings->step, settings->weighting, settings->threads);
+		if (!table)
+			return 0;
+
+		struct tiles_t
+		{
+			const unsigned char **faces;
+			const sh__table *table;
+			int tilesPerFace;
+			m_vec3 (*partials)[count];
+			float *weightSums;
+		} tiles = { faces, table, (table->ny + SH_TILE_ROWS - 1) / SH_TILE_ROWS, 0, 0 };
+		int n = SH_FACES * tiles.tilesPerFace;
+		tiles.partials = (m_vec3(*)[count])calloc(n, sizeof(m_vec3[count]));
+		tiles.weightSums = (float*)calloc(n, sizeof(float));
+		if (!tiles.partials || !tiles.weightSums)
+		{
+			free(tiles.partials);
+			free(tiles.weightSums);
+			return 0;
+		}
+
+		sh_parallel_for(n, settings->threads, [](void *user, int index)
+		{
+			tiles_t *tiles = (tiles_t*)user;
+			const sh__table *t = tiles->table;
+			int face = index / tiles->tilesPerFace;
+			int j0 = (index % tiles->tilesPerFace) * SH_TILE_ROWS;
+			int j1 = m_mini(j0 + SH_TILE_ROWS, t->ny);
+			const m_vec3 X = sh__skyX[face], Y = sh__skyY[face], D = sh__skyDir[face];
+			m_vec3 *sum = tiles->partials[index];
+			float weightSum = 0.0f;
+			for (int j = j0; j < j1; j++)
+			{
+				const unsigned char *p = tiles->faces[face] + (size_t)j * t->step * t->w * 3;
+				const float *il = t->il + (size_t)j * t->stride;
+				const float *weight = t->weight + (size_t)j * t->stride;
+				m_vec3 c = m_add3(m_scale3(Y, t->v[j]), D);
+				for (int i = 0; i < t->nx; i++, p += 3 * t->step)
+				{
+					m_vec3 dir = m_scale3(m_add3(m_scale3(X, t->u[i]), c), il[i]);
+					float b[count];
+					basis(dir.x, dir.y, dir.z, b);
+					m_vec3 light = m_scale3(m_v3(p[0], p[1], p[2]), weight[i] / 255.0f);
+					for (int k = 0; k < count; k++)
+						sum[k] = m_add3(sum[k], m_scale3(light, b[k]));
+					weightSum += weight[i];
+				}
+			}
+			tiles->weightSums[index] = weightSum;
+		}, &tiles);
+
+		m_vec3 sum[count] = {};
+		float weightSum = 0.0f;
+		for (int i = 0; i < n; i++)
+		{
+			for (int k = 0; k < count; k++)
+				sum[k] = m_add3(sum[k], tiles.partials[i][k]);
+			weightSum += tiles.weightSums[i];
+		}
+		free(tiles.partials);
+		free(tiles.weightSums);
+		for (int k = 0; k < count; k++)
+			coefficients[k] = m_scale3(sum[k], 4.0f * M_M_PI / weightSum);
+		return 1;
+	}
+
+	// writes a GLSL function "vec3 <function>(vec3 n)" that evaluates the
+	// coefficients in the uniform array <uniform> (declared by the caller).
+	// returns the number of characters needed (like snprintf).
+	static int glsl(char *out, size_t size, const char *function, const char *uniform)
+	{
+		int length = 0;
+		auto emit = [&](const char *format, auto... args)
+		{
+			int n = snprintf(out ? out + m_mini(length, (int)size) : 0, out && length < (int)size ? size - length : 0, format, args...);
+			length += n > 0 ? n : 0;
+		};
+		emit("vec3 %s(vec3 n)\n{\n", function);
+		emit("    float x = n.x, y = n.y, z = n.z;\n");
+		emit("    float C0 = 1.0, S0 = 0.0;\n");
+		for (int m = 1; m <= L; m++)
+			emit("    float C%d = x * C%d - y * S%d, S%d = x * S%d + y * C%d;\n", m, m - 1, m - 1, m, m - 1, m - 1);
+		for (int m = 0; m <= L; m++)
+		{
+			for (int l = m; l <= L; l++)
+			{
+				if (l == m)
+					emit("    float Q%d_%d = %#.9g;\n", l, m, sh__qmm(m));
+				else if (l == m + 1)
+					emit("    float Q%d_%d = %#.9g * z * Q%d_%d;\n", l, m, 2.0 * m + 1.0, m, m);
+				else
+					emit("    float Q%d_%d = %#.9g * z * Q%d_%d - %#.9g * Q%d_%d;\n", l, m, sh__qa(l, m), l - 1, m, sh__qb(l, m), l - 2, m);
+			}
+		}
+		emit("    vec3 result = vec3(0.0);\n");
+		for (int l = 0; l <= L; l++)
+		{
+			for (int m = -l; m <= l; m++)
+			{
+				int am = m < 0 ? -m : m;
+				emit("    result += (%#.9g * Q%d_%d * %c%d) * %s[%d];\n", sh__normalization(l, am), l, am, m < 0 ? 'S' : 'C', am, uniform, l * (l + 1) + m);
+			}
+		}
+		emit("    return result;\n}\n");
+		return length;
+	}
+};
+
+#endif
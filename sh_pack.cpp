@@ -0,0 +1,187 @@
+/***********************************************************
+* Compact storage of coefficient sets: half floats and     *
+* 8 bit ratios to coefficient 0                            *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <string.h>
+#include <math.h>
+
+#include "sh_project.h"
+#include "sh_kernel.h"
+
+// round to nearest even, clamped to the largest finite half
+static unsigned short sh__float_to_half(float f)
+{
+	unsigned int bits;
+	memcpy(&bits, &f, sizeof(bits));
+	unsigned int sign = (bits >> 16) & 0x8000;
+	bits &= 0x7fffffff;
+	unsigned int h;
+	if (bits > 0x7f800000) // nan
+		h = 0x7e00;
+	else if (bits >= 0x477ff000) // rounds to 65520 or more
+		h = 0x7bff;
+	else if (bits < (113u << 23)) // half denormal or zero: let the float adder round
+	{
+		const unsigned int half = 126u << 23; // 0.5f moves the half denormal bits to the bottom
+		float a, b;
+		memcpy(&a, &bits, sizeof(a));
+		memcpy(&b, &half, sizeof(b));
+		a += b;
+		memcpy(&bits, &a, sizeof(bits));
+		h = bits - half;
+	}
+	else
+	{
+		unsigned int odd = (bits >> 13) & 1;
+		bits += (unsigned int)(15 - 127) * (1u << 23) + 0xfff + odd;
+		h = bits >> 13;
+	}
+	return (unsigned short)(h | sign);
+}
+
+static void sh__pack_half(const m_vec3 *coefficients, int count, unsigned short *packed)
+{
+	const float *c = &coefficients[0].x;
+	for (size_t i = 0; i < (size_t)count * SH_COEFFICIENTS * 3; i++)
+		packed[i] = sh__float_to_half(c[i]);
+}
+
+static void sh__pack_ratio8(const m_vec3 *coefficients, int count, sh__ratio8 *packed)
+{
+	for (int p = 0; p < count; p++, coefficients += SH_COEFFICIENTS, packed++)
+	{
+		// the ratios are taken to the decoded coefficient 0
+		const float *c = &coefficients[0].x;
+		float l0[3], scale = 0.0f;
+		for (int ch = 0; ch < 3; ch++)
+		{
+			packed->l0[ch] = sh__float_to_half(c[ch]);
+			l0[ch] = sh__half_to_float(packed->l0[ch]);
+		}
+		for (int i = 3; i < SH_COEFFICIENTS * 3; i++)
+			if (l0[i % 3] > 0.0f)
+				scale = m_maxf(scale, fabsf(c[i] / l0[i % 3]));
+
+		// round the scale up, so no ratio gets clamped
+		unsigned short h = sh__float_to_half(scale);
+		if (sh__half_to_float(h) < scale && h < 0x7bff)
+			h++;
+		packed->l0[3] = h;
+
+		// the same step as sh__unpack_ratio8_scalar
+		float k = sh__half_to_float(h) / 127.0f;
+		for (int i = 3; i < SH_COEFFICIENTS * 3; i++)
+		{
+			float step = l0[i % 3] > 0.0f ? l0[i % 3] * k : 0.0f;
+			float q = step > 0.0f ? floorf(c[i] / step + 0.5f) : 0.0f;
+			packed->ratios[i - 3] = (signed char)m_clampf(q, -127.0f, 127.0f);
+		}
+	}
+}
+
+static void sh__unpack_half_scalar(const void *packed, int count, m_vec3 *coefficients)
+{
+	const unsigned short *h = (const unsigned short*)packed;
+	float *c = &coefficients[0].x;
+	for (size_t i = 0; i < (size_t)count * SH_COEFFICIENTS * 3; i++)
+		c[i] = sh__half_to_float(h[i]);
+}
+
+static void sh__unpack_ratio8_scalar(const void *packed, int count, m_vec3 *coefficients)
+{
+	const sh__ratio8 *p = (const sh__ratio8*)packed;
+	for (int i = 0; i < count; i++, p++)
+	{
+		float *c = &coefficients[(size_t)i * SH_COEFFICIENTS].x;
+		float k = sh__half_to_float(p->l0[3]) / 127.0f;
+		float step[3];
+		for (int ch = 0; ch < 3; ch++)
+		{
+			c[ch] = sh__half_to_float(p->l0[ch]);
+			step[ch] = c[ch] * k;
+		}
+		for (int j = 0; j < 24; j++)
+			c[3 + j] = (float)p->ratios[j] * step[j % 3];
+	}
+}
+
+static sh__unpack sh__select_unpack(sh_pack_format format, sh_kernel kernel)
+{
+	int ratio = format == SH_PACK_RATIO8;
+#ifdef SH_KERNEL_X86
+	if ((kernel == SH_KERNEL_AUTO || kernel == SH_KERNEL_AVX2) && sh_kernel_supported(SH_KERNEL_AVX2))
+		return ratio ? sh__unpack_ratio8_avx2 : sh__unpack_half_avx2;
+	if (kernel != SH_KERNEL_SCALAR)
+		return ratio ? sh__unpack_ratio8_sse2 : sh__unpack_half_sse2;
+#endif
+	return ratio ? sh__unpack_ratio8_scalar : sh__unpack_half_scalar;
+}
+
+const char *sh_pack_name(sh_pack_format format)
+{
+	switch (format)
+	{
+	case SH_PACK_HALF:   return "half";
+	case SH_PACK_RATIO8: return "ratio8";
+	}
+	return "unknown";
+}
+
+size_t sh_pack_size(sh_pack_format format)
+{
+	return format == SH_PACK_RATIO8 ? sizeof(sh__ratio8) : SH_COEFFICIENTS * 3 * sizeof(unsigned short);
+}
+
+void sh_pack(sh_pack_format format, const m_vec3 *coefficients, int count, void *packed)
+{
+	if (format == SH_PACK_RATIO8)
+		sh__pack_ratio8(coefficients, count, (sh__ratio8*)packed);
+	else
+		sh__pack_half(coefficients, count, (unsigned short*)packed);
+}
+
+void sh_unpack(sh_pack_format format, const void *packed, int count, sh_kernel kernel, m_vec3 *coefficients)
+{
+	sh__select_unpack(format, kernel)(packed, count, coefficients);
+}
+
+void sh_pack_report(sh_pack_format format, const m_vec3 *coefficients, int count, sh_pack_error *error)
+{
+	// in chunks on the stack
+	enum { chunk = 64 };
+	sh__ratio8 packed[chunk * 2]; // large enough for either format
+	m_vec3 unpacked[chunk * SH_COEFFICIENTS];
+	double sum = 0.0;
+	memset(error, 0, sizeof(*error));
+	for (int p0 = 0; p0 < count; p0 += chunk)
+	{
+		int n = m_mini(chunk, count - p0);
+		const m_vec3 *c = coefficients + (size_t)p0 * SH_COEFFICIENTS;
+		sh_pack(format, c, n, packed);
+		sh_unpack(format, packed, n, SH_KERNEL_AUTO, unpacked);
+		for (int p = 0; p < n; p++)
+		{
+			const float *a = &c[p * SH_COEFFICIENTS].x, *b = &unpacked[p * SH_COEFFICIENTS].x;
+			double l0 = m_maxf(m_maxf(a[0], a[1]), a[2]), largest = 0.0;
+			for (int i = 0; i < SH_COEFFICIENTS * 3; i++)
+			{
+				double d = fabs((double)a[i] - b[i]);
+				sum += d * d;
+				largest = d > largest ? d : largest;
+			}
+			error->max = largest > error->max ? largest : error->max;
+			if (l0 > 0.0 && largest / l0 > error->relative)
+				error->relative = largest / l0;
+		}
+	}
+	error->rms = count > 0 ? sqrt(sum / ((double)count * SH_COEFFICIENTS * 3)) : 0.0;
+}
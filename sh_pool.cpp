@@ -0,0 +1,128 @@
+/***********************************************************
+* A tiny persistent worker pool for parallel for loops     *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sh_pool.h"
+
+static thread_local bool sh__insidePool = false;
+
+typedef struct sh__pool
+{
+	std::mutex callMutex; // one sh_parallel_for at a time
+	std::mutex mutex;
+	std::condition_variable wake, finished;
+	std::vector<std::thread> threads;
+	unsigned generation = 0;
+	int active = 0; // workers currently inside the job
+	bool quit = false;
+
+	// current job
+	sh_task task = 0;
+	void *user = 0;
+	int count = 0;
+	int workers = 0;
+	std::atomic<int> next;
+
+	~sh__pool()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			quit = true;
+		}
+		wake.notify_all();
+		for (size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+	}
+} sh__pool;
+
+static sh__pool& sh__getPool()
+{
+	static sh__pool pool;
+	return pool;
+}
+
+static void sh__runJob(sh__pool *pool)
+{
+	for (int i = pool->next.fetch_add(1); i < pool->count; i = pool->next.fetch_add(1))
+		pool->task(pool->user, i);
+}
+
+static void sh__worker(sh__pool *pool, int id)
+{
+	sh__insidePool = true;
+	unsigned seen = 0;
+	std::unique_lock<std::mutex> lock(pool->mutex);
+	for (;;)
+	{
+		pool->wake.wait(lock, [&] { return pool->quit || pool->generation != seen; });
+		if (pool->quit)
+			return;
+		seen = pool->generation;
+		if (id >= pool->workers - 1) // the caller is the last worker
+			continue;
+
+		pool->active++;
+		lock.unlock();
+		sh__runJob(pool);
+		lock.lock();
+		if (--pool->active == 0)
+			pool->finished.notify_all();
+	}
+}
+
+int sh_hardware_threads(void)
+{
+	int n = (int)std::thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+void sh_parallel_for(int count, int threads, sh_task task, void *user)
+{
+	int workers = threads > 0 ? threads : sh_hardware_threads();
+	if (workers > count)
+		workers = count;
+	if (workers <= 1 || sh__insidePool)
+	{
+		for (int i = 0; i < count; i++)
+			task(user, i);
+		return;
+	}
+
+	sh__pool *pool = &sh__getPool();
+	std::unique_lock<std::mutex> call(pool->callMutex);
+	{
+		std::unique_lock<std::mutex> lock(pool->mutex);
+		// late wakers of the previous job must be gone before it is replaced
+		pool->finished.wait(lock, [&] { return pool->active == 0; });
+		while ((int)pool->threads.size() < workers - 1)
+			pool->threads.push_back(std::thread(sh__worker, pool, (int)pool->threads.size()));
+		pool->task = task;
+		pool->user = user;
+		pool->count = count;
+		pool->workers = workers;
+		pool->next.store(0);
+		pool->generation++;
+	}
+	pool->wake.notify_all();
+
+	sh__insidePool = true;
+	sh__runJob(pool);
+	sh__insidePool = false;
+
+	std::unique_lock<std::mutex> lock(pool->mutex);
+	pool->finished.wait(lock, [&] { return pool->active == 0; });
+}
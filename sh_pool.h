@@ -0,0 +1,35 @@
+/***********************************************************
+* A tiny persistent worker pool for parallel for loops     *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#ifndef SH_POOL_H
+#define SH_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*sh_task)(void *user, int index);
+
+// number of hardware threads (at least 1)
+int sh_hardware_threads(void);
+
+// calls task(user, i) for every i in [0, count) on up to threads threads
+// (0: all hardware threads). the calling thread takes part in the work.
+// indices are handed out dynamically, so tasks must not depend on which
+// thread runs them. nested calls from inside a task run serially.
+void sh_parallel_for(int count, int threads, sh_task task, void *user);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,676 @@
+/***********************************************************
+* GL-free spherical harmonics projection of cubemaps       *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "sh_project.h"
+#include "sh_kernel.h"
+#include "sh_pool.h"
+
+#if defined(_MSC_VER) && defined(SH_KERNEL_X86)
+#include <intrin.h>
+#endif
+
+const char *sh_faceNames[SH_FACES] = { "posx", "negx", "posy", "negy", "posz", "negz" };
+
+const m_vec3 sh__skyDir[SH_FACES] = {
+	{  1.0f,  0.0f,  0.0f }, { -1.0f,  0.0f,  0.0f },
+	{  0.0f,  1.0f,  0.0f }, {  0.0f, -1.0f,  0.0f },
+	{  0.0f,  0.0f,  1.0f }, {  0.0f,  0.0f, -1.0f }
+};
+const m_vec3 sh__skyX[SH_FACES] = {
+	{  0.0f,  0.0f, -1.0f }, {  0.0f,  0.0f,  1.0f },
+	{ -1.0f,  0.0f,  0.0f }, {  1.0f,  0.0f,  0.0f },
+	{  1.0f,  0.0f,  0.0f }, { -1.0f,  0.0f,  0.0f }
+};
+const m_vec3 sh__skyY[SH_FACES] = {
+	{  0.0f,  1.0f,  0.0f }, {  0.0f,  1.0f,  0.0f },
+	{  0.0f,  0.0f, -1.0f }, {  0.0f,  0.0f,  1.0f },
+	{  0.0f,  1.0f,  0.0f }, {  0.0f,  1.0f,  0.0f }
+};
+
+void sh_accum_init(sh_accum *acc)
+{
+	memset(acc, 0, sizeof(sh_accum));
+}
+
+void sh_accum_add(sh_accum *a, const sh_accum *b)
+{
+	for (int s = 0; s < SH_COEFFICIENTS; s++)
+		a->coefficients[s] = m_add3(a->coefficients[s], b->coefficients[s]);
+	a->weightSum += b->weightSum;
+}
+
+void sh_settings_init(sh_settings *settings)
+{
+	settings->step = 16;
+	settings->resolution = 0;
+	settings->threads = 0;
+	settings->kernel = SH_KERNEL_AUTO;
+	settings->weighting = SH_WEIGHT_APPROX;
+	settings->cacheFile = 0;
+	settings->stream = 0;
+}
+
+const char *sh_kernel_name(sh_kernel kernel)
+{
+	switch (kernel)
+	{
+	case SH_KERNEL_AUTO:   return "auto";
+	case SH_KERNEL_SCALAR: return "scalar";
+	case SH_KERNEL_SSE2:   return "sse2";
+	case SH_KERNEL_AVX2:   return "avx2";
+	}
+	return "unknown";
+}
+
+#ifdef SH_KERNEL_X86
+static int sh__cpu_has_avx2_fma()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	int osxsave = (info[2] >> 27) & 1, avx = (info[2] >> 28) & 1, fma = (info[2] >> 12) & 1;
+	if (!osxsave || !avx || !fma || (_xgetbv(0) & 6) != 6) // os saves the ymm registers?
+		return 0;
+	__cpuidex(info, 7, 0);
+	return (info[1] >> 5) & 1;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+#endif
+
+int sh_kernel_supported(sh_kernel kernel)
+{
+	switch (kernel)
+	{
+	case SH_KERNEL_AUTO:
+	case SH_KERNEL_SCALAR:
+		return 1;
+#ifdef SH_KERNEL_X86
+	case SH_KERNEL_SSE2:
+		return 1; // x86 baseline for our builds
+	case SH_KERNEL_AVX2:
+	{
+		static int avx2 = sh__cpu_has_avx2_fma();
+		return avx2;
+	}
+#else
+	default:
+		break;
+#endif
+	}
+	return 0;
+}
+
+static sh__rows sh__select_rows(sh_kernel kernel, sh__format format)
+{
+	int f = format == SH__RGBF;
+#ifdef SH_KERNEL_X86
+	if ((kernel == SH_KERNEL_AUTO || kernel == SH_KERNEL_AVX2) && sh_kernel_supported(SH_KERNEL_AVX2))
+		return f ? sh__project_rows_rgbf_avx2 : sh__project_rows_rgb8_avx2;
+	if (kernel != SH_KERNEL_SCALAR)
+		return f ? sh__project_rows_rgbf_sse2 : sh__project_rows_rgb8_sse2;
+#endif
+	return f ? sh__project_rows_rgbf_scalar : sh__project_rows_rgb8_scalar;
+}
+
+template <typename T>
+static void sh__project_rows_scalar(sh_accum *acc, int face, const void *pixels, size_t rowBytes, const sh__table *table, int j0, int j1, float scale)
+{
+	const m_vec3 X = sh__skyX[face], Y = sh__skyY[face], D = sh__skyDir[face];
+	for (int j = j0; j < j1; j++)
+	{
+		const T *p = (const T*)((const char*)pixels + (size_t)(j - j0) * rowBytes);
+		const float *il = table->il + (size_t)j * table->stride;
+		const float *weight = table->weight + (size_t)j * table->stride;
+		m_vec3 c = m_add3(m_scale3(Y, table->v[j]), D);
+		for (int i = 0; i < table->nx; i++)
+		{
+			m_vec3 n = m_scale3(m_add3(m_scale3(X, table->u[i]), c), il[i]); // texelDirection
+			m_vec3 c_light = m_scale3(m_v3(p[0], p[1], p[2]), weight[i] * scale);
+			sh__accumulate(acc, n, c_light);
+			p += 3 * table->step;
+			acc->weightSum += weight[i];
+		}
+	}
+}
+
+void sh__project_rows_rgb8_scalar(sh_accum *acc, int face, const void *pixels, size_t rowBytes, const sh__table *table, int j0, int j1)
+{
+	sh__project_rows_scalar<unsigned char>(acc, face, pixels, rowBytes, table, j0, j1, 1.0f / 255.0f);
+}
+
+void sh__project_rows_rgbf_scalar(sh_accum *acc, int face, const void *pixels, size_t rowBytes, const sh__table *table, int j0, int j1)
+{
+	sh__project_rows_scalar<float>(acc, face, pixels, rowBytes, table, j0, j1, 1.0f);
+}
+
+static int sh__project_face(sh_accum *acc, int face, const void *pixels, sh__format format, int w, int h, const sh_settings *settings)
+{
+	if (w < 2 || h < 2 || settings->step < 1)
+		return 0;
+	const sh__table *table = sh__get_table(w, h, settings->step, settings->weighting, settings->threads);
+	if (!table)
+		return 0;
+	sh__select_rows(settings->kernel, format)(acc, face, pixels, sh__sampled_row_bytes(table, format), table, 0, table->ny);
+	return 1;
+}
+
+int sh_project_face_rgb8(sh_accum *acc, int face, const unsigned char *rgb, int w, int h, const sh_settings *settings)
+{
+	return sh__project_face(acc, face, rgb, SH__RGB8, w, h, settings);
+}
+
+int sh_project_face_rgbf(sh_accum *acc, int face, const float *rgb, int w, int h, const sh_settings *settings)
+{
+	return sh__project_face(acc, face, rgb, SH__RGBF, w, h, settings);
+}
+
+void sh_accum_finish(const sh_accum *acc, m_vec3 *coefficients)
+{
+	for (int s = 0; s < SH_COEFFICIENTS; s++)
+		coefficients[s] = m_scale3(acc->coefficients[s], 4.0f * M_M_PI / acc->weightSum);
+}
+
+typedef struct sh__tiles
+{
+	const void **faces;
+	const sh__table *table;
+	size_t rowBytes;
+	int tilesPerFace;
+	sh__rows rows;
+	sh_accum *partials; // one per tile
+} sh__tiles;
+
+static void sh__project_tile(void *user, int index)
+{
+	sh__tiles *tiles = (sh__tiles*)user;
+	int face = index / tiles->tilesPerFace;
+	int tile = index % tiles->tilesPerFace;
+	int j0 = tile * SH_TILE_ROWS;
+	int j1 = m_mini(j0 + SH_TILE_ROWS, tiles->table->ny);
+	sh_accum_init(&tiles->partials[index]);
+	const char *pixels = (const char*)tiles->faces[face] + (size_t)j0 * tiles->rowBytes;
+	tiles->rows(&tiles->partials[index], face, pixels, tiles->rowBytes, tiles->table, j0, j1);
+}
+
+static int sh__downsample_face(const void *pixels, sh__format format, int w, int h, int dw, int dh, int threads, void *out)
+{
+	if (format == SH__RGBF)
+		return sh_downsample_face_rgbf((const float*)pixels, w, h, dw, dh, threads, (float*)out);
+	return sh_downsample_face_rgb8((const unsigned char*)pixels, w, h, dw, dh, threads, (unsigned char*)out);
+}
+
+static int sh__project_cubemap(const void **faces, sh__format format, int w, int h, const sh_settings *settings, m_vec3 *coefficients);
+
+static int sh__project_downsampled(const void **faces, sh__format format, int w, int h, const sh_settings *settings, m_vec3 *coefficients)
+{
+	int dw = m_mini(settings->resolution, w), dh = m_mini(settings->resolution, h);
+	size_t faceSize = (size_t)dw * dh * sh__texel_size(format);
+	unsigned char *small = (unsigned char*)malloc(SH_FACES * faceSize);
+	if (!small)
+		return 0;
+	const void *smallFaces[SH_FACES];
+	for (int i = 0; i < SH_FACES; i++)
+		smallFaces[i] = small + i * faceSize;
+
+	int result = 0;
+	if (dw >= 2 && dh >= 2)
+	{
+		if (format == SH__RGBF)
+			result = sh_downsample_cubemap_rgbf((const float**)faces, w, h, dw, dh, settings->threads, (float**)smallFaces);
+		else
+			result = sh_downsample_cubemap_rgb8((const unsigned char**)faces, w, h, dw, dh, settings->threads, (unsigned char**)smallFaces);
+	}
+	if (result)
+	{
+		sh_settings full = *settings;
+		full.step = 1;
+		full.resolution = 0;
+		result = sh__project_cubemap(smallFaces, format, dw, dh, &full, coefficients);
+	}
+	free(small);
+	return result;
+}
+
+static int sh__project_cubemap(const void **faces, sh__format format, int w, int h, const sh_settings *settings, m_vec3 *coefficients)
+{
+	if (w < 2 || h < 2 || settings->step < 1)
+		return 0;
+	if (settings->resolution > 0)
+	{
+		if (settings->resolution < w || settings->resolution < h)
+			return sh__project_downsampled(faces, format, w, h, settings, coefficients);
+		sh_settings full = *settings;
+		full.step = 1;
+		full.resolution = 0;
+		return sh__project_cubemap(faces, format, w, h, &full, coefficients);
+	}
+
+	// the tiling only depends on the image size and step, never on the
+	// thread count, and the partial sums are reduced in tile order.
+	sh__tiles tiles;
+	tiles.faces = faces;
+	tiles.table = sh__get_table(w, h, settings->step, settings->weighting, settings->threads);
+	if (!tiles.table)
+		return 0;
+	tiles.rowBytes = sh__sampled_row_bytes(tiles.table, format);
+	tiles.rows = sh__select_rows(settings->kernel, format);
+	tiles.tilesPerFace = (tiles.table->ny + SH_TILE_ROWS - 1) / SH_TILE_ROWS;
+	int count = SH_FACES * tiles.tilesPerFace;
+	tiles.partials = (sh_accum*)malloc(count * sizeof(sh_accum));
+	if (!tiles.partials)
+		return 0;
+
+	sh_parallel_for(count, settings->threads, sh__project_tile, &tiles);
+
+	sh_accum acc;
+	sh_accum_init(&acc);
+	for (int i = 0; i < count; i++)
+		sh_accum_add(&acc, &tiles.partials[i]);
+	free(tiles.partials);
+	sh_accum_finish(&acc, coefficients);
+	return 1;
+}
+
+int sh_project_cubemap_rgb8(const unsigned char **faces, int w, int h, const sh_settings *settings, m_vec3 *coefficients)
+{
+	return sh__project_cubemap((const void**)faces, SH__RGB8, w, h, settings, coefficients);
+}
+
+int sh_project_cubemap_rgbf(const float **faces, int w, int h, const sh_settings *settings, m_vec3 *coefficients)
+{
+	return sh__project_cubemap((const void**)faces, SH__RGBF, w, h, settings, coefficients);
+}
+
+int sh_cubemap_accum_init(sh_cubemap_accum *acc, int w, int h, const sh_settings *settings)
+{
+	memset(acc, 0, sizeof(sh_cubemap_accum));
+	if (w < 2 || h < 2 || settings->step < 1)
+		return 0;
+	acc->w = w;
+	acc->h = h;
+	acc->settings = *settings;
+	acc->pw = w;
+	acc->ph = h;
+	if (settings->resolution > 0)
+	{
+		acc->pw = m_mini(settings->resolution, w);
+		acc->ph = m_mini(settings->resolution, h);
+		acc->settings.step = 1;
+		if (acc->pw < 2 || acc->ph < 2)
+			return 0;
+	}
+	const sh__table *table = sh__get_table(acc->pw, acc->ph, acc->settings.step, settings->weighting, settings->threads);
+	if (!table)
+		return 0;
+	acc->tiles = (table->ny + SH_TILE_ROWS - 1) / SH_TILE_ROWS;
+	return 1;
+}
+
+void sh_cubemap_accum_free(sh_cubemap_accum *acc)
+{
+	for (int i = 0; i < SH_FACES; i++)
+	{
+		free(acc->partials[i]);
+		acc->partials[i] = 0;
+	}
+}
+
+typedef struct sh__accum_tiles
+{
+	const void *pixels;
+	int face;
+	const sh__table *table;
+	size_t rowBytes;
+	sh__rows rows;
+	sh_accum *partials;
+	int first; // tile of index 0
+} sh__accum_tiles;
+
+static void sh__accum_update_tile(void *user, int index)
+{
+	sh__accum_tiles *u = (sh__accum_tiles*)user;
+	int tile = u->first + index;
+	int j0 = tile * SH_TILE_ROWS;
+	int j1 = m_mini(j0 + SH_TILE_ROWS, u->table->ny);
+	sh_accum_init(&u->partials[tile]);
+	u->rows(&u->partials[tile], u->face, (const char*)u->pixels + (size_t)j0 * u->rowBytes, u->rowBytes, u->table, j0, j1);
+}
+
+// projects the tiles holding the texel rows [y0, y1) of a face
+static int sh__accum_update(sh_cubemap_accum *acc, int face, const void *pixels, sh__format format, int y0, int y1)
+{
+	if (!acc->tiles || face < 0 || face >= SH_FACES)
+		return 0;
+	const sh_settings *settings = &acc->settings;
+	void *small = 0;
+	if (acc->pw != acc->w || acc->ph != acc->h)
+	{
+		small = malloc((size_t)acc->pw * acc->ph * sh__texel_size(format));
+		if (!small || !sh__downsample_face(pixels, format, acc->w, acc->h, acc->pw, acc->ph, settings->threads, small))
+		{
+			free(small);
+			return 0;
+		}
+		pixels = small;
+		y0 = 0;
+		y1 = acc->ph;
+	}
+	if (!acc->partials[face])
+	{
+		acc->partials[face] = (sh_accum*)calloc(acc->tiles, sizeof(sh_accum));
+		y0 = 0;
+		y1 = acc->ph;
+	}
+	if (!acc->partials[face])
+	{
+		free(small);
+		return 0;
+	}
+
+	// sampled rows j cover the texel rows j * step, tiles SH_TILE_ROWS of them
+	sh__accum_tiles u;
+	u.pixels = pixels;
+	u.face = face;
+	u.table = sh__get_table(acc->pw, acc->ph, settings->step, settings->weighting, settings->threads);
+	u.rowBytes = u.table ? sh__sampled_row_bytes(u.table, format) : 0;
+	u.rows = sh__select_rows(settings->kernel, format);
+	u.partials = acc->partials[face];
+	int tileTexels = SH_TILE_ROWS * settings->step;
+	u.first = m_maxi(y0, 0) / tileTexels;
+	int last = m_mini((m_mini(y1, acc->ph) + tileTexels - 1) / tileTexels, acc->tiles);
+	if (u.table && last > u.first)
+		sh_parallel_for(last - u.first, settings->threads, sh__accum_update_tile, &u);
+	free(small);
+	return u.table != 0;
+}
+
+int sh_cubemap_accum_face_rgb8(sh_cubemap_accum *acc, int face, const unsigned char *rgb)
+{
+	return sh__accum_update(acc, face, rgb, SH__RGB8, 0, acc->h);
+}
+
+int sh_cubemap_accum_face_rgbf(sh_cubemap_accum *acc, int face, const float *rgb)
+{
+	return sh__accum_update(acc, face, rgb, SH__RGBF, 0, acc->h);
+}
+
+int sh_cubemap_accum_rows_rgb8(sh_cubemap_accum *acc, int face, const unsigned char *rgb, int y0, int y1)
+{
+	return sh__accum_update(acc, face, rgb, SH__RGB8, y0, y1);
+}
+
+int sh_cubemap_accum_rows_rgbf(sh_cubemap_accum *acc, int face, const float *rgb, int y0, int y1)
+{
+	return sh__accum_update(acc, face, rgb, SH__RGBF, y0, y1);
+}
+
+int sh_cubemap_accum_finish(const sh_cubemap_accum *acc, m_vec3 *coefficients)
+{
+	for (int i = 0; i < SH_FACES; i++)
+		if (!acc->partials[i])
+			return 0;
+	// same reduction order as sh__project_cubemap
+	sh_accum sum;
+	sh_accum_init(&sum);
+	for (int i = 0; i < SH_FACES; i++)
+		for (int j = 0; j < acc->tiles; j++)
+			sh_accum_add(&sum, &acc->partials[i][j]);
+	sh_accum_finish(&sum, coefficients);
+	return 1;
+}
+
+typedef struct sh__loader
+{
+	const char **files;
+	const sh_settings *settings;
+	sh__format format;
+	int keep;    // hand the decoded faces to the caller
+	int project; // 0: only decode (cache hit)
+	void *faces[SH_FACES];
+	int w[SH_FACES], h[SH_FACES];
+	int tiles[SH_FACES];
+	sh_accum *partials[SH_FACES]; // tiles[face] row tiles each
+} sh__loader;
+
+// the projection half of sh__project_cubemap for a single face. the tiles
+// run serially here, the parallelism comes from the six faces.
+static int sh__project_face_tiles(sh__loader *l, int face, const void *pixels, int w, int h)
+{
+	const sh_settings *settings = l->settings;
+	int step = settings->resolution > 0 ? 1 : settings->step;
+	void *small = 0;
+	if (settings->resolution > 0 && (settings->resolution < w || settings->resolution < h))
+	{
+		int dw = m_mini(settings->resolution, w), dh = m_mini(settings->resolution, h);
+		small = malloc((size_t)dw * dh * sh__texel_size(l->format));
+		if (!small || dw < 2 || dh < 2 || !sh__downsample_face(pixels, l->format, w, h, dw, dh, 1, small))
+		{
+			free(small);
+			return 0;
+		}
+		pixels = small;
+		w = dw;
+		h = dh;
+	}
+
+	const sh__table *table = sh__get_table(w, h, step, settings->weighting, 1);
+	sh__rows rows = sh__select_rows(settings->kernel, l->format);
+	int count = table ? (table->ny + SH_TILE_ROWS - 1) / SH_TILE_ROWS : 0;
+	sh_accum *partials = count ? (sh_accum*)malloc(count * sizeof(sh_accum)) : 0;
+	size_t rowBytes = table ? sh__sampled_row_bytes(table, l->format) : 0;
+	for (int i = 0; partials && i < count; i++)
+	{
+		int j0 = i * SH_TILE_ROWS;
+		sh_accum_init(&partials[i]);
+		rows(&partials[i], face, (const char*)pixels + (size_t)j0 * rowBytes, rowBytes, table, j0, m_mini(j0 + SH_TILE_ROWS, table->ny));
+	}
+	free(small);
+	l->tiles[face] = count;
+	l->partials[face] = partials;
+	return partials != 0;
+}
+
+int sh__decode_scale(const char *file, int minW, int minH)
+{
+	int w, h, c, scale = 0;
+	if (minW <= 0 || minH <= 0 || !stbi_info(file, &w, &h, &c))
+		return 0;
+	while (scale < 3 && (w >> (scale + 1)) >= minW && (h >> (scale + 1)) >= minH &&
+		!(w & ((2 << scale) - 1)) && !(h & ((2 << scale) - 1)))
+		scale++;
+	return scale;
+}
+
+// row by row projection of a face while it is decoded
+typedef struct sh__face_stream
+{
+	sh__loader *l;
+	int face;
+	const sh__table *table;
+	sh__rows rows;
+	sh__stream stream;
+	int started, failed;
+} sh__face_stream;
+
+static void sh__face_stream_tile(sh__stream *stream, sh_accum *acc, const void *pixels, size_t rowBytes, int j0, int j1)
+{
+	sh__face_stream *f = (sh__face_stream*)stream->user;
+	f->rows(acc, f->face, pixels, rowBytes, f->table, j0, j1);
+}
+
+static void sh__face_stream_row(void *user, const void *row, int y, int w, int h)
+{
+	sh__face_stream *f = (sh__face_stream*)user;
+	if (y == 0)
+	{
+		// same sizes as sh__project_face_tiles
+		const sh_settings *settings = f->l->settings;
+		int pw = w, ph = h, step = settings->step;
+		if (settings->resolution > 0)
+		{
+			pw = m_mini(settings->resolution, w);
+			ph = m_mini(settings->resolution, h);
+			step = 1;
+		}
+		f->table = pw >= 2 && ph >= 2 ? sh__get_table(pw, ph, step, settings->weighting, 1) : 0;
+		f->rows = sh__select_rows(settings->kernel, f->l->format);
+		f->failed = !f->table || !sh__stream_init(&f->stream, f->l->format, w, h, pw, ph, step, f->table->ny, sh__face_stream_tile, f);
+		f->started = 1;
+	}
+	if (!f->failed)
+		sh__stream_row(&f->stream, row);
+}
+
+static void sh__load_face_streamed(sh__loader *l, int face)
+{
+	const char *file = l->files[face];
+	sh__face_stream f;
+	memset(&f, 0, sizeof(f));
+	f.l = l;
+	f.face = face;
+	int c, ok;
+	if (l->format == SH__RGBF)
+		ok = stbi_loadf_rows(file, &l->w[face], &l->h[face], &c, 3, sh__face_stream_row, &f);
+	else
+		ok = stbi_load_rows(file, &l->w[face], &l->h[face], &c, 3, sh__decode_scale(file, l->settings->resolution, l->settings->resolution), sh__face_stream_row, &f);
+	if (!ok)
+		fprintf(stderr, "Error loading %s\n", file);
+	else if (!f.started || f.failed)
+		fprintf(stderr, "Error projecting %s\n", file);
+	else
+	{
+		l->tiles[face] = f.stream.tiles;
+		l->partials[face] = f.stream.partials;
+		f.stream.partials = 0;
+	}
+	sh__stream_free(&f.stream);
+}
+
+static void sh__load_face(void *user, int face)
+{
+	sh__loader *l = (sh__loader*)user;
+	if (l->settings->stream && l->project && !l->keep)
+	{
+		sh__load_face_streamed(l, face);
+		return;
+	}
+	const char *file = l->files[face];
+	int c;
+	void *pixels;
+	if (l->format == SH__RGBF)
+		pixels = stbi_loadf(file, &l->w[face], &l->h[face], &c, 3);
+	else
+		pixels = stbi_load_scaled(file, &l->w[face], &l->h[face], &c, 3, l->keep ? 0 : sh__decode_scale(file, l->settings->resolution, l->settings->resolution));
+	if (!pixels)
+	{
+		fprintf(stderr, "Error loading %s\n", file);
+		return;
+	}
+	if (l->project && (l->w[face] < 2 || l->h[face] < 2 || !sh__project_face_tiles(l, face, pixels, l->w[face], l->h[face])))
+		fprintf(stderr, "Error projecting %s\n", file);
+	if (l->keep)
+		l->faces[face] = pixels;
+	else
+		stbi_image_free(pixels);
+}
+
+static int sh__load_cubemap(const char **files, sh__format format, const sh_settings *settings, void **faces, int *w, int *h, m_vec3 *coefficients)
+{
+	if (settings->step < 1)
+		return 0;
+	sh__loader l;
+	memset(&l, 0, sizeof(l));
+	l.files = files;
+	l.settings = settings;
+	l.format = format;
+	l.keep = faces != 0;
+	l.project = 1;
+
+	unsigned long long key = 0;
+	int cached = settings->cacheFile && sh__cache_key(files, SH_FACES, settings, format,
+		!l.keep && format == SH__RGB8 && settings->resolution > 0, &key); // scaled JPEG decode
+	if (cached && sh__cache_load(settings->cacheFile, key, coefficients))
+	{
+		if (!l.keep)
+			return 1;
+		l.project = 0;
+	}
+
+	sh_parallel_for(SH_FACES, settings->threads, sh__load_face, &l);
+
+	int result = 1;
+	for (int i = 0; i < SH_FACES && result; i++)
+	{
+		if (l.project ? !l.partials[i] : !l.faces[i])
+			result = 0;
+		else if (l.w[i] != l.w[0] || l.h[i] != l.h[0])
+		{
+			fprintf(stderr, "Error: %s has a different size than %s\n", files[i], files[0]);
+			result = 0;
+		}
+	}
+	if (result && l.project)
+	{
+		// same reduction order as sh__project_cubemap
+		sh_accum acc;
+		sh_accum_init(&acc);
+		for (int i = 0; i < SH_FACES; i++)
+			for (int j = 0; j < l.tiles[i]; j++)
+				sh_accum_add(&acc, &l.partials[i][j]);
+		sh_accum_finish(&acc, coefficients);
+		if (cached)
+			sh__cache_store(settings->cacheFile, key, coefficients);
+	}
+	for (int i = 0; i < SH_FACES; i++)
+	{
+		free(l.partials[i]);
+		if (!result)
+			stbi_image_free(l.faces[i]);
+		if (faces)
+			faces[i] = result ? l.faces[i] : 0;
+	}
+	if (result && w) *w = l.w[0];
+	if (result && h) *h = l.h[0];
+	return result;
+}
+
+int sh_is_hdr_file(const char *file)
+{
+	return stbi_is_hdr(file);
+}
+
+int sh_project_cubemap_files(const char **files, const sh_settings *settings, m_vec3 *coefficients)
+{
+	sh__format format = sh_is_hdr_file(files[0]) ? SH__RGBF : SH__RGB8;
+	return sh__load_cubemap(files, format, settings, 0, 0, 0, coefficients);
+}
+
+int sh_load_cubemap_rgb8(const char **files, const sh_settings *settings, unsigned char **faces, int *w, int *h, m_vec3 *coefficients)
+{
+	return sh__load_cubemap(files, SH__RGB8, settings, (void**)faces, w, h, coefficients);
+}
+
+int sh_load_cubemap_rgbf(const char **files, const sh_settings *settings, float **faces, int *w, int *h, m_vec3 *coefficients)
+{
+	return sh__load_cubemap(files, SH__RGBF, settings, (void**)faces, w, h, coefficients);
+}
@@ -0,0 +1,266 @@
+/***********************************************************
+* GL-free spherical harmonics projection of cubemaps       *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#ifndef SH_PROJECT_H
+#define SH_PROJECT_H
+
+#include <math.h>
+#include "m_math.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SH_COEFFICIENTS 9
+
+// faces are ordered like the GL cubemap targets: +x, -x, +y, -y, +z, -z
+#define SH_FACES 6
+extern const char *sh_faceNames[SH_FACES]; // "posx", "negx", ...
+
+// all projections produce radiance SH: coefficient k is the integral of
+// radiance times basis function k over the sphere. convolve them with a
+// zonal harmonic kernel (sh_convolve) to get e.g. diffuse lighting.
+
+// running sums of a projection that is still in progress
+typedef struct sh_accum
+{
+	m_vec3 coefficients[SH_COEFFICIENTS];
+	float weightSum;
+} sh_accum;
+
+void sh_accum_init(sh_accum *acc);
+
+// adds b to a
+void sh_accum_add(sh_accum *a, const sh_accum *b);
+
+typedef enum sh_kernel
+{
+	SH_KERNEL_AUTO,   // fastest kernel the cpu supports
+	SH_KERNEL_SCALAR,
+	SH_KERNEL_SSE2,   // 4 texels per iteration
+	SH_KERNEL_AVX2    // 8 texels per iteration, needs avx2 + fma
+} sh_kernel;
+
+const char *sh_kernel_name(sh_kernel kernel);
+int sh_kernel_supported(sh_kernel kernel);
+
+typedef enum sh_weighting
+{
+	SH_WEIGHT_APPROX, // 1 / l^3 at the sampled texel
+	SH_WEIGHT_EXACT   // exact solid angle of the step x step block behind each sample
+} sh_weighting;
+
+typedef struct sh_settings
+{
+	int step;         // project every step'th texel in x and y
+	int resolution;   // > 0: box filter the faces down to this size first and project all of its texels (step is ignored)
+	int threads;      // 0: all hardware threads
+	sh_kernel kernel;
+	sh_weighting weighting;
+	const char *cacheFile; // != 0: file projections are looked up in / added to this coefficient cache
+	int stream;       // 1: file projections decode and project row by row, never holding a whole image
+} sh_settings;
+
+void sh_settings_init(sh_settings *settings); // step 16, no downsampling, all threads, auto kernel, approx weights, no cache, no streaming
+
+// adds every step'th texel of one tightly packed RGB8 face to acc (single threaded)
+int sh_project_face_rgb8(sh_accum *acc, int face, const unsigned char *rgb, int w, int h, const sh_settings *settings);
+// same for linear float radiance (3 floats per texel), nothing is clamped
+int sh_project_face_rgbf(sh_accum *acc, int face, const float *rgb, int w, int h, const sh_settings *settings);
+
+// sample directions and weights are cached per (resolution, step, weighting)
+// for all later projections. frees them, must not run concurrently with a projection.
+void sh_free_tables(void);
+
+// settings->cacheFile is read into memory once and new projections are only
+// added there. writes every changed cache file in one go, with one record per
+// key (also done when the program exits). returns 0 if a file could not be written.
+int sh_flush_cache(void);
+
+// normalizes the sums to the full sphere (4 * pi / weightSum)
+void sh_accum_finish(const sh_accum *acc, m_vec3 *coefficients);
+
+// area filters the faces down to dw x dh (<= w x h) in one pass over the
+// source rows. out[i] must hold dw * dh * 3 bytes. returns 0 on failure.
+int sh_downsample_cubemap_rgb8(const unsigned char **faces, int w, int h, int dw, int dh, int threads, unsigned char **out);
+int sh_downsample_face_rgb8(const unsigned char *rgb, int w, int h, int dw, int dh, int threads, unsigned char *out);
+int sh_downsample_cubemap_rgbf(const float **faces, int w, int h, int dw, int dh, int threads, float **out);
+int sh_downsample_face_rgbf(const float *rgb, int w, int h, int dw, int dh, int threads, float *out);
+
+// whole cubemap projections, return 0 on failure.
+// the faces are split into row tiles that are projected in parallel and
+// summed up in a fixed order, so the result is bit-identical for any
+// number of threads.
+int sh_project_cubemap_rgb8(const unsigned char **faces, int w, int h, const sh_settings *settings, m_vec3 *coefficients);
+int sh_project_cubemap_rgbf(const float **faces, int w, int h, const sh_settings *settings, m_vec3 *coefficients);
+
+// incremental projection of a cubemap whose faces change independently.
+// the row tile sums of every face are kept, so replacing a face (or some of
+// its rows) only projects those texels again. finishing sums up all tiles
+// in the order of sh_project_cubemap_rgb8 and gives the identical result,
+// nothing is subtracted, so no error builds up over many updates.
+typedef struct sh_cubemap_accum
+{
+	int w, h;                     // face size
+	sh_settings settings;
+	int pw, ph;                   // projected face size (w x h or the filtered resolution)
+	int tiles;                    // row tiles per face
+	sh_accum *partials[SH_FACES]; // tiles each, 0 until the face was set
+} sh_cubemap_accum;
+
+int sh_cubemap_accum_init(sh_cubemap_accum *acc, int w, int h, const sh_settings *settings);
+void sh_cubemap_accum_free(sh_cubemap_accum *acc);
+
+// (re)projects a whole w x h face
+int sh_cubemap_accum_face_rgb8(sh_cubemap_accum *acc, int face, const unsigned char *rgb);
+int sh_cubemap_accum_face_rgbf(sh_cubemap_accum *acc, int face, const float *rgb);
+
+// only the texel rows [y0, y1) of an already set face changed (rgb is the
+// whole face). with settings->resolution > 0 the whole face is filtered again.
+int sh_cubemap_accum_rows_rgb8(sh_cubemap_accum *acc, int face, const unsigned char *rgb, int y0, int y1);
+int sh_cubemap_accum_rows_rgbf(sh_cubemap_accum *acc, int face, const float *rgb, int y0, int y1);
+
+// normalized coefficients, 0 while a face is missing
+int sh_cubemap_accum_finish(const sh_cubemap_accum *acc, m_vec3 *coefficients);
+
+// quasi monte carlo projection with a cost that does not depend on the face
+// size: uniformly distributed directions (Hammersley points mapped to the
+// sphere by area) are bilinearly fetched from the faces. the points come in
+// batches of SH_QMC_BATCH, each with its own Cranley-Patterson rotation, so
+// the batches are independent estimates: coefficients is their mean and
+// error (can be 0) the standard error of that mean per coefficient.
+// stops after samples directions (> 0) or once seconds have passed (> 0),
+// whichever comes first, but never before 2 batches. e.g. samples 0,
+// seconds 0.0005 gives the best estimate 0.5 ms allow. the same sample count
+// always gives the same result. single threaded, returns the number of
+// directions used, 0 on failure.
+#define SH_QMC_BATCH 256
+int sh_project_cubemap_qmc_rgb8(const unsigned char **faces, int w, int h, int samples, double seconds, m_vec3 *coefficients, m_vec3 *error);
+int sh_project_cubemap_qmc_rgbf(const float **faces, int w, int h, int samples, double seconds, m_vec3 *coefficients, m_vec3 *error);
+
+// 1 if the file is a Radiance .hdr image
+int sh_is_hdr_file(const char *file);
+
+// the six files are decoded in parallel and every face is projected by the
+// thread that decoded it, as soon as it is done. the result is the same as
+// decoding everything first and calling sh_project_cubemap_rgb8.
+// with settings->resolution > 0, JPEG faces are already decoded at 1/2, 1/4
+// or 1/8 size in the DCT domain as long as that stays >= resolution.
+// if files[0] is an .hdr image, all faces go through the float path.
+// with settings->cacheFile, a cache hit (same file contents and settings)
+// skips decoding and projection completely.
+// with settings->stream, every face is projected while it is decoded: baseline
+// JPEGs only keep 3 MCU rows, .hdr files a single row, and the filter and
+// projection SH_TILE_ROWS rows, so the memory does not grow with the face
+// size. progressive JPEGs and other formats are still decoded whole first.
+// the result is bit-identical either way.
+int sh_project_cubemap_files(const char **files, const sh_settings *settings, m_vec3 *coefficients);
+
+// like sh_project_cubemap_files, but always decodes at full size and hands the
+// pixels (w * h * 3 bytes per face, free with free()) to the caller, e.g. for
+// a texture upload on the GL thread. a cache hit only skips the projection.
+int sh_load_cubemap_rgb8(const char **files, const sh_settings *settings, unsigned char **faces, int *w, int *h, m_vec3 *coefficients);
+// float version (w * h * 3 floats per face). 8 bit files are linearized by stb_image (gamma 2.2).
+int sh_load_cubemap_rgbf(const char **files, const sh_settings *settings, float **faces, int *w, int *h, m_vec3 *coefficients);
+
+// rotation of whole coefficient sets, so turning the environment needs no
+// new projection. sh_rotation_init builds the block diagonal 3x3 (band 1)
+// and 5x5 (band 2) matrices in closed form from a quaternion, sh_rotate then
+// costs 34 multiply-adds per color channel and coefficient set.
+// q rotates the environment: what was seen in direction d is seen in q d.
+// convolution is per band, so it can happen before or after the rotation.
+typedef struct sh_rotation
+{
+	float band1[3][3];
+	float band2[5][5];
+} sh_rotation;
+
+void sh_rotation_init(sh_rotation *rotation, m_quat q);
+
+// rotates count sets of SH_COEFFICIENTS coefficients, in may be equal to out
+void sh_rotate(const sh_rotation *rotation, const m_vec3 *in, m_vec3 *out, int count);
+
+// rotationally symmetric convolution kernels as one factor per band, for
+// bands = L + 1 bands (3 for the 9 coefficients). every kernel integrates to 1
+// over the sphere, so factors[0] is 1 and the average radiance is kept.
+// clamped cosine / pi (1, 2/3, 1/4, 0, -1/24, ...): radiance to the exit
+// radiance of a white lambertian surface (irradiance / pi)
+void sh_lambert_factors(int bands, float *factors);
+// normalized phong lobe (n + 1) / (2 pi) max(cos, 0)^n, n = 1 is lambert
+void sh_phong_factors(int bands, float exponent, float *factors);
+// gaussian (heat kernel) blur of about width radians: exp(-l (l + 1) width^2 / 2)
+void sh_gaussian_factors(int bands, float width, float *factors);
+
+// multiplies every coefficient of band l by factors[l] in count sets of
+// SH_COEFFICIENTS coefficients. one projection serves any number of kernels.
+void sh_convolve(m_vec3 *coefficients, const float *factors, int count);
+
+// equirectangular (lat-long) images, w x h texels covering 360 x 180 degrees.
+// the top row looks up (+y), the image center looks down -z and x grows
+// towards +x. sin/cos of the sample angles and the per row and column solid
+// angles are cached per (resolution, step, weighting) like the face tables.
+// settings->resolution > 0 area filters to 4 * resolution x 2 * resolution first.
+int sh_project_latlong_rgb8(const unsigned char *rgb, int w, int h, const sh_settings *settings, m_vec3 *coefficients);
+int sh_project_latlong_rgbf(const float *rgb, int w, int h, const sh_settings *settings, m_vec3 *coefficients);
+
+// decodes (.hdr through the float path, scaled JPEG decode like the cubemap
+// files) and projects a lat-long image file, using settings->cacheFile and
+// settings->stream. streaming projects the tiles serially.
+int sh_project_latlong_file(const char *file, const sh_settings *settings, m_vec3 *coefficients);
+
+// compact storage for large probe sets. SH_PACK_RATIO8 assumes non-negative
+// radiance (or its convolutions), where every higher coefficient is at most
+// about 2.24 times coefficient 0; a coefficient 0 channel <= 0 loses its L1
+// and L2. values beyond the half float range are clamped to +-65504.
+typedef enum sh_pack_format
+{
+	SH_PACK_HALF,   // 27 half floats, 54 bytes per set (2x smaller)
+	SH_PACK_RATIO8  // coefficient 0 as half rgb, the others as signed 8 bit ratios
+	                // to it per channel with a half scale per set, 32 bytes (3.4x smaller)
+} sh_pack_format;
+
+const char *sh_pack_name(sh_pack_format format);
+size_t sh_pack_size(sh_pack_format format); // bytes per coefficient set
+
+// packs count sets of SH_COEFFICIENTS coefficients into count * sh_pack_size bytes
+void sh_pack(sh_pack_format format, const m_vec3 *coefficients, int count, void *packed);
+// batch decode with the SSE2 / AVX2 kernels, the result does not depend on the kernel
+void sh_unpack(sh_pack_format format, const void *packed, int count, sh_kernel kernel, m_vec3 *coefficients);
+
+// round trip error of count coefficient sets
+typedef struct sh_pack_error
+{
+	double rms;      // over all coefficients and channels
+	double max;      // largest absolute coefficient error
+	double relative; // largest coefficient error / largest coefficient 0 channel of its set
+} sh_pack_error;
+
+void sh_pack_report(sh_pack_format format, const m_vec3 *coefficients, int count, sh_pack_error *error);
+
+// evaluation of the coefficients (usually convolved, e.g. with
+// sh_lambert_factors for an irradiance map) at the texel centers of a size x
+// size cubemap, the inverse of the exact projection. faces[i] receives
+// size * size * 3 floats in the same face order and orientation as the
+// projection input. rows are split across settings->threads like the
+// projection, settings->kernel picks the SIMD width.
+int sh_reconstruct_cubemap(const m_vec3 *coefficients, int size, const sh_settings *settings, float **faces);
+// the same for a w x h lat-long image (w * h * 3 floats)
+int sh_reconstruct_latlong(const m_vec3 *coefficients, int w, int h, const sh_settings *settings, float *rgb);
+
+// writes w x h rgb floats as an uncompressed Radiance .hdr file
+int sh_write_hdr(const char *file, const float *rgb, int w, int h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,143 @@
+/***********************************************************
+* Quasi monte carlo projection of cubemaps with a fixed    *
+* sample or time budget                                    *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <chrono>
+
+#include "sh_project.h"
+#include "sh_kernel.h"
+
+static double sh__now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// van der corput sequence, the second Hammersley coordinate
+static float sh__radical_inverse(unsigned int i)
+{
+	i = (i << 16) | (i >> 16);
+	i = ((i & 0x55555555u) << 1) | ((i & 0xAAAAAAAAu) >> 1);
+	i = ((i & 0x33333333u) << 2) | ((i & 0xCCCCCCCCu) >> 2);
+	i = ((i & 0x0F0F0F0Fu) << 4) | ((i & 0xF0F0F0F0u) >> 4);
+	i = ((i & 0x00FF00FFu) << 8) | ((i & 0xFF00FF00u) >> 8);
+	return (float)(i * 2.3283064365386963e-10);
+}
+
+static float sh__frac(float x)
+{
+	return x - floorf(x);
+}
+
+// the face that direction n hits and the face local (u, v) in [-1, 1]
+// (the same coordinates as sh__table: direction = X u + Y v + D)
+static int sh__cube_face(m_vec3 n, float *u, float *v)
+{
+	float ax = fabsf(n.x), ay = fabsf(n.y), az = fabsf(n.z);
+	int face = ax >= ay && ax >= az ? (n.x < 0.0f) : ay >= az ? 2 + (n.y < 0.0f) : 4 + (n.z < 0.0f);
+	float d = 1.0f / m_dot3(n, sh__skyDir[face]);
+	*u = m_dot3(n, sh__skyX[face]) * d;
+	*v = m_dot3(n, sh__skyY[face]) * d;
+	return face;
+}
+
+// bilinear between the texel centers, clamped at the face edges
+template <typename T>
+static m_vec3 sh__fetch_bilinear(const T *face, int w, int h, float u, float v)
+{
+	float fx = m_clampf((u + 1.0f) * 0.5f * w - 0.5f, 0.0f, w - 1.0f);
+	float fy = m_clampf((1.0f - v) * 0.5f * h - 0.5f, 0.0f, h - 1.0f);
+	int x0 = (int)fx, y0 = (int)fy;
+	int x1 = m_mini(x0 + 1, w - 1), y1 = m_mini(y0 + 1, h - 1);
+	float ax = fx - x0, ay = fy - y0;
+	const T *p00 = face + ((size_t)y0 * w + x0) * 3, *p10 = face + ((size_t)y0 * w + x1) * 3;
+	const T *p01 = face + ((size_t)y1 * w + x0) * 3, *p11 = face + ((size_t)y1 * w + x1) * 3;
+	float w00 = (1.0f - ax) * (1.0f - ay), w10 = ax * (1.0f - ay), w01 = (1.0f - ax) * ay, w11 = ax * ay;
+	return m_v3(
+		p00[0] * w00 + p10[0] * w10 + p01[0] * w01 + p11[0] * w11,
+		p00[1] * w00 + p10[1] * w10 + p01[1] * w01 + p11[1] * w11,
+		p00[2] * w00 + p10[2] * w10 + p01[2] * w01 + p11[2] * w11);
+}
+
+// one batch of SH_QMC_BATCH Hammersley points, Cranley-Patterson rotated by
+// the batch'th point of the R2 sequence and mapped to the sphere by area
+template <typename T>
+static void sh__project_batch(const T **faces, int w, int h, float scale, int batch, m_vec3 *coefficients)
+{
+	float sx = sh__frac(0.5f + batch * 0.7548776662f), sy = sh__frac(0.5f + batch * 0.5698402910f);
+	sh_accum acc;
+	sh_accum_init(&acc);
+	for (int i = 0; i < SH_QMC_BATCH; i++)
+	{
+		float z = 1.0f - 2.0f * sh__frac((i + 0.5f) / SH_QMC_BATCH + sx);
+		float phi = 2.0f * M_M_PI * sh__frac(sh__radical_inverse(i) + sy);
+		float r = sqrtf(m_maxf(0.0f, 1.0f - z * z));
+		m_vec3 n = m_v3(r * cosf(phi), r * sinf(phi), z);
+		float u, v;
+		int face = sh__cube_face(n, &u, &v);
+		sh__accumulate(&acc, n, m_scale3(sh__fetch_bilinear(faces[face], w, h, u, v), scale));
+	}
+	for (int i = 0; i < SH_COEFFICIENTS; i++)
+		coefficients[i] = acc.coefficients[i];
+}
+
+template <typename T>
+static int sh__project_qmc(const T **faces, int w, int h, float pixelScale, int samples, double seconds, m_vec3 *coefficients, m_vec3 *error)
+{
+	if (w < 1 || h < 1 || (samples <= 0 && seconds <= 0.0))
+		return 0;
+	double start = sh__now();
+	int batches = samples > 0 ? m_maxi(2, (samples + SH_QMC_BATCH - 1) / SH_QMC_BATCH) : 0x7fffffff;
+	float scale = pixelScale * 4.0f * M_M_PI / SH_QMC_BATCH; // uniform pdf 1 / (4 pi)
+
+	// running mean and squared deviations of the batch estimates (welford)
+	double mean[SH_COEFFICIENTS * 3], m2[SH_COEFFICIENTS * 3];
+	memset(mean, 0, sizeof(mean));
+	memset(m2, 0, sizeof(m2));
+	int k = 0;
+	while (k < batches)
+	{
+		// stop before the batch that would exceed the time budget
+		double elapsed = sh__now() - start;
+		if (k >= 2 && seconds > 0.0 && elapsed * (k + 1) / k > seconds)
+			break;
+		m_vec3 b[SH_COEFFICIENTS];
+		sh__project_batch(faces, w, h, scale, k++, b);
+		const float *x = &b[0].x;
+		for (int i = 0; i < SH_COEFFICIENTS * 3; i++)
+		{
+			double d = x[i] - mean[i];
+			mean[i] += d / k;
+			m2[i] += d * (x[i] - mean[i]);
+		}
+	}
+
+	float *c = &coefficients[0].x, *e = error ? &error[0].x : 0;
+	for (int i = 0; i < SH_COEFFICIENTS * 3; i++)
+	{
+		c[i] = (float)mean[i];
+		if (e)
+			e[i] = (float)sqrt(m2[i] / ((double)(k - 1) * k)); // standard error of the mean
+	}
+	return k * SH_QMC_BATCH;
+}
+
+int sh_project_cubemap_qmc_rgb8(const unsigned char **faces, int w, int h, int samples, double seconds, m_vec3 *coefficients, m_vec3 *error)
+{
+	return sh__project_qmc(faces, w, h, 1.0f / 255.0f, samples, seconds, coefficients, error);
+}
+
+int sh_project_cubemap_qmc_rgbf(const float **faces, int w, int h, int samples, double seconds, m_vec3 *coefficients, m_vec3 *error)
+{
+	return sh__project_qmc(faces, w, h, 1.0f, samples, seconds, coefficients, error);
+}
@@ -0,0 +1,156 @@
+/***********************************************************
+* Evaluation of coefficients back into cubemap and lat-long *
+* images, e.g. irradiance maps                             *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "sh_project.h"
+#include "sh_kernel.h"
+#include "sh_pool.h"
+
+static void sh__eval_rows_scalar(const m_vec3 *coefficients, int face, const sh__table *table, int j0, int j1, float *out)
+{
+	const m_vec3 X = sh__skyX[face], Y = sh__skyY[face], D = sh__skyDir[face];
+	for (int j = j0; j < j1; j++)
+	{
+		const float *il = table->il + (size_t)j * table->stride;
+		m_vec3 c = m_add3(m_scale3(Y, table->v[j]), D);
+		for (int i = 0; i < table->nx; i++, out += 3)
+		{
+			m_vec3 rgb = sh__evaluate(coefficients, m_scale3(m_add3(m_scale3(X, table->u[i]), c), il[i]));
+			out[0] = rgb.x; out[1] = rgb.y; out[2] = rgb.z;
+		}
+	}
+}
+
+static void sh__eval_latlong_rows_scalar(const m_vec3 *coefficients, const sh__latlong_table *table, int j0, int j1, float *out)
+{
+	for (int j = j0; j < j1; j++)
+	{
+		float st = table->sinTheta[j], ct = table->cosTheta[j];
+		for (int i = 0; i < table->nx; i++, out += 3)
+		{
+			m_vec3 rgb = sh__evaluate(coefficients, m_v3(st * table->sinPhi[i], ct, -st * table->cosPhi[i]));
+			out[0] = rgb.x; out[1] = rgb.y; out[2] = rgb.z;
+		}
+	}
+}
+
+static sh__eval_rows sh__select_eval_rows(sh_kernel kernel)
+{
+#ifdef SH_KERNEL_X86
+	if ((kernel == SH_KERNEL_AUTO || kernel == SH_KERNEL_AVX2) && sh_kernel_supported(SH_KERNEL_AVX2))
+		return sh__eval_rows_avx2;
+	if (kernel != SH_KERNEL_SCALAR)
+		return sh__eval_rows_sse2;
+#endif
+	return sh__eval_rows_scalar;
+}
+
+static sh__eval_latlong_rows sh__select_eval_latlong_rows(sh_kernel kernel)
+{
+#ifdef SH_KERNEL_X86
+	if ((kernel == SH_KERNEL_AUTO || kernel == SH_KERNEL_AVX2) && sh_kernel_supported(SH_KERNEL_AVX2))
+		return sh__eval_latlong_rows_avx2;
+	if (kernel != SH_KERNEL_SCALAR)
+		return sh__eval_latlong_rows_sse2;
+#endif
+	return sh__eval_latlong_rows_scalar;
+}
+
+// the images are split into tiles of SH_TILE_ROWS rows like the projection
+typedef struct sh__eval_tiles
+{
+	const m_vec3 *coefficients;
+	const sh__table *table;
+	const sh__latlong_table *latlongTable;
+	sh__eval_rows rows;
+	sh__eval_latlong_rows latlongRows;
+	float **out;
+	int w, h, tilesPerImage;
+} sh__eval_tiles;
+
+static void sh__eval_tile(void *user, int index)
+{
+	sh__eval_tiles *t = (sh__eval_tiles*)user;
+	int image = index / t->tilesPerImage;
+	int j0 = index % t->tilesPerImage * SH_TILE_ROWS;
+	int j1 = m_mini(j0 + SH_TILE_ROWS, t->h);
+	float *out = t->out[image] + (size_t)j0 * t->w * 3;
+	if (t->table)
+		t->rows(t->coefficients, image, t->table, j0, j1, out);
+	else
+		t->latlongRows(t->coefficients, t->latlongTable, j0, j1, out);
+}
+
+int sh_reconstruct_cubemap(const m_vec3 *coefficients, int size, const sh_settings *settings, float **faces)
+{
+	// texel centers and exact directions, the same as the exact projection
+	sh__eval_tiles t;
+	memset(&t, 0, sizeof(t));
+	t.coefficients = coefficients;
+	t.table = size > 0 ? sh__get_table(size, size, 1, SH_WEIGHT_EXACT, settings->threads) : 0;
+	if (!t.table)
+		return 0;
+	t.rows = sh__select_eval_rows(settings->kernel);
+	t.out = faces;
+	t.w = t.h = size;
+	t.tilesPerImage = (size + SH_TILE_ROWS - 1) / SH_TILE_ROWS;
+	sh_parallel_for(SH_FACES * t.tilesPerImage, settings->threads, sh__eval_tile, &t);
+	return 1;
+}
+
+int sh_reconstruct_latlong(const m_vec3 *coefficients, int w, int h, const sh_settings *settings, float *rgb)
+{
+	sh__eval_tiles t;
+	memset(&t, 0, sizeof(t));
+	t.coefficients = coefficients;
+	t.latlongTable = w > 0 && h > 0 ? sh__get_latlong_table(w, h, 1, SH_WEIGHT_EXACT) : 0;
+	if (!t.latlongTable)
+		return 0;
+	t.latlongRows = sh__select_eval_latlong_rows(settings->kernel);
+	t.out = &rgb;
+	t.w = w;
+	t.h = h;
+	t.tilesPerImage = (h + SH_TILE_ROWS - 1) / SH_TILE_ROWS;
+	sh_parallel_for(t.tilesPerImage, settings->threads, sh__eval_tile, &t);
+	return 1;
+}
+
+int sh_write_hdr(const char *file, const float *rgb, int w, int h)
+{
+	FILE *f = fopen(file, "wb");
+	if (!f)
+		return 0;
+	// flat (not run length encoded) RGBE scanlines
+	fprintf(f, "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y %d +X %d\n", h, w);
+	for (size_t i = 0; i < (size_t)w * h; i++, rgb += 3)
+	{
+		unsigned char rgbe[4] = { 0, 0, 0, 0 };
+		float m = m_maxf(m_maxf(rgb[0], rgb[1]), rgb[2]);
+		if (m > 1e-32f)
+		{
+			int e;
+			float s = frexpf(m, &e) * 256.0f / m;
+			rgbe[0] = (unsigned char)(m_maxf(rgb[0], 0.0f) * s);
+			rgbe[1] = (unsigned char)(m_maxf(rgb[1], 0.0f) * s);
+			rgbe[2] = (unsigned char)(m_maxf(rgb[2], 0.0f) * s);
+			rgbe[3] = (unsigned char)(e + 128);
+		}
+		fwrite(rgbe, 4, 1, f);
+	}
+	int result = !ferror(f);
+	fclose(f);
+	return result;
+}
@@ -0,0 +1,101 @@
+/***********************************************************
+* Rotation of 9 coefficient spherical harmonics            *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <math.h>
+
+#include "sh_project.h"
+
+// band 2 basis constants: 1.092548 xy, 0.315392 (3z^2 - 1), 0.546274 (x^2 - y^2)
+static const double sh__k2a = 1.0925484305920792; // 0.5 sqrt(15 / pi)
+static const double sh__k2b = 0.3153915652525200; // 0.25 sqrt(5 / pi)
+static const double sh__k2c = 0.5462742152960396; // 0.25 sqrt(15 / pi)
+
+// on the unit sphere, band 2 of c is the quadratic form d^T M d with a
+// symmetric, traceless M (3 z^2 - 1 = 2 z^2 - x^2 - y^2)
+static void sh__band2_to_quadratic(const double *c, double M[3][3])
+{
+	M[0][0] = -sh__k2b * c[2] + sh__k2c * c[4];
+	M[1][1] = -sh__k2b * c[2] - sh__k2c * c[4];
+	M[2][2] = 2.0 * sh__k2b * c[2];
+	M[0][1] = M[1][0] = 0.5 * sh__k2a * c[0];
+	M[1][2] = M[2][1] = -0.5 * sh__k2a * c[1];
+	M[0][2] = M[2][0] = -0.5 * sh__k2a * c[3];
+}
+
+static void sh__quadratic_to_band2(const double M[3][3], double *c)
+{
+	c[0] = 2.0 * M[0][1] / sh__k2a;
+	c[1] = -2.0 * M[1][2] / sh__k2a;
+	c[2] = M[2][2] / (2.0 * sh__k2b);
+	c[3] = -2.0 * M[0][2] / sh__k2a;
+	c[4] = (M[0][0] - M[1][1]) / (2.0 * sh__k2c);
+}
+
+void sh_rotation_init(sh_rotation *rotation, m_quat q)
+{
+	// R moves the environment: the rotated radiance in direction d is the
+	// original radiance in direction R^T d
+	double x = q.x, y = q.y, z = q.z, w = q.w;
+	double s = 2.0 / (x * x + y * y + z * z + w * w);
+	double R[3][3] = {
+		{ 1.0 - s * (y * y + z * z), s * (x * y - w * z),       s * (x * z + w * y)       },
+		{ s * (x * y + w * z),       1.0 - s * (x * x + z * z), s * (y * z - w * x)       },
+		{ s * (x * z - w * y),       s * (y * z + w * x),       1.0 - s * (x * x + y * y) }
+	};
+
+	// band 1 is d . v with v = (-c3, -c1, c2), which simply becomes R v
+	static const int axis[3] = { 1, 2, 0 };
+	static const double sign[3] = { -1.0, 1.0, -1.0 };
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			rotation->band1[i][j] = (float)(sign[i] * sign[j] * R[axis[i]][axis[j]]);
+
+	// band 2 is d^T M d, which becomes d^T (R M R^T) d.
+	// column j of the 5x5 block is the rotated j'th basis function.
+	for (int j = 0; j < 5; j++)
+	{
+		double c[5] = { 0.0 }, M[3][3], RM[3][3], S[3][3];
+		c[j] = 1.0;
+		sh__band2_to_quadratic(c, M);
+		for (int a = 0; a < 3; a++)
+			for (int b = 0; b < 3; b++)
+				RM[a][b] = R[a][0] * M[0][b] + R[a][1] * M[1][b] + R[a][2] * M[2][b];
+		for (int a = 0; a < 3; a++)
+			for (int b = 0; b < 3; b++)
+				S[a][b] = RM[a][0] * R[b][0] + RM[a][1] * R[b][1] + RM[a][2] * R[b][2];
+		sh__quadratic_to_band2(S, c);
+		for (int i = 0; i < 5; i++)
+			rotation->band2[i][j] = (float)c[i];
+	}
+}
+
+void sh_rotate(const sh_rotation *rotation, const m_vec3 *in, m_vec3 *out, int count)
+{
+	for (int p = 0; p < count; p++, in += SH_COEFFICIENTS, out += SH_COEFFICIENTS)
+	{
+		m_vec3 r[SH_COEFFICIENTS];
+		r[0] = in[0];
+		for (int i = 0; i < 3; i++)
+		{
+			const float *m = rotation->band1[i];
+			r[1 + i] = m_add3(m_add3(m_scale3(in[1], m[0]), m_scale3(in[2], m[1])), m_scale3(in[3], m[2]));
+		}
+		for (int i = 0; i < 5; i++)
+		{
+			const float *m = rotation->band2[i];
+			r[4 + i] = m_add3(m_add3(m_add3(m_add3(m_scale3(in[4], m[0]), m_scale3(in[5], m[1])),
+				m_scale3(in[6], m[2])), m_scale3(in[7], m[3])), m_scale3(in[8], m[4]));
+		}
+		for (int i = 0; i < SH_COEFFICIENTS; i++) // in may be out
+			out[i] = r[i];
+	}
+}
@@ -0,0 +1,70 @@
+/***********************************************************
+* Projection of images that are decoded row by row, so no  *
+* whole face is ever held in memory                        *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sh_project.h"
+#include "sh_kernel.h"
+
+int sh__stream_init(sh__stream *stream, sh__format format, int w, int h, int pw, int ph, int step, int ny, sh__stream_tile project, void *user)
+{
+	memset(stream, 0, sizeof(sh__stream));
+	if (pw < 2 || ph < 2 || pw > w || ph > h || step < 1 || ny < 1)
+		return 0;
+	stream->format = format;
+	stream->pw = pw;
+	stream->ph = ph;
+	stream->step = step;
+	stream->ny = ny;
+	stream->project = project;
+	stream->user = user;
+	stream->filtered = pw != w || ph != h;
+	stream->rowBytes = (size_t)pw * sh__texel_size(format);
+	stream->tiles = (ny + SH_TILE_ROWS - 1) / SH_TILE_ROWS;
+	stream->rows = (unsigned char*)malloc(SH_TILE_ROWS * stream->rowBytes);
+	stream->partials = (sh_accum*)malloc(stream->tiles * sizeof(sh_accum));
+	if (!stream->rows || !stream->partials || (stream->filtered && !sh__row_filter_init(&stream->filter, format, w, h, pw, ph)))
+	{
+		sh__stream_free(stream);
+		return 0;
+	}
+	return 1;
+}
+
+void sh__stream_row(sh__stream *stream, const void *row)
+{
+	if (stream->filtered && !(row = sh__row_filter_add(&stream->filter, row)))
+		return; // the filtered row is not complete yet
+	int y = stream->y++;
+	int j = y / stream->step;
+	if (y % stream->step || j >= stream->ny)
+		return;
+	memcpy(stream->rows + stream->buffered++ * stream->rowBytes, row, stream->rowBytes);
+	if (stream->buffered == SH_TILE_ROWS || j + 1 == stream->ny)
+	{
+		int tile = j / SH_TILE_ROWS;
+		sh_accum_init(&stream->partials[tile]);
+		stream->project(stream, &stream->partials[tile], stream->rows, stream->rowBytes, tile * SH_TILE_ROWS, j + 1);
+		stream->buffered = 0;
+	}
+}
+
+void sh__stream_free(sh__stream *stream)
+{
+	if (stream->filtered)
+		sh__row_filter_free(&stream->filter);
+	free(stream->rows);
+	free(stream->partials);
+	memset(stream, 0, sizeof(sh__stream));
+}
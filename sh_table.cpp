@@ -0,0 +1,238 @@
+/***********************************************************
+* Cached per resolution direction and solid angle tables   *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mutex>
+#include <vector>
+
+#include "sh_kernel.h"
+#include "sh_pool.h"
+
+static std::mutex sh__tablesMutex;
+static std::vector<sh__table*> sh__tables;
+static std::vector<sh__latlong_table*> sh__latlongTables;
+
+// solid angle of the face region from the face center to (x, y) in [-1, 1]^2
+static double sh__areaElement(double x, double y)
+{
+	return atan2(x * y, sqrt(x * x + y * y + 1.0));
+}
+
+// texel coordinate of the edge between the blocks of sample i - 1 and i
+static double sh__blockEdge(int i, int step, int n, int size)
+{
+	if (i <= 0) return 0.0;
+	if (i >= n) return size;
+	return i * step - 0.5 * step + 0.5; // halfway between the texel centers
+}
+
+static void sh__build_table_row(void *user, int j)
+{
+	sh__table *t = (sh__table*)user;
+	float *il = t->il + j * t->stride;
+	float *weight = t->weight + j * t->stride;
+	if (t->weighting == SH_WEIGHT_EXACT)
+	{
+		// every sample stands for the texels closer to it than to its neighbours,
+		// so the blocks tile the face without gaps and the weights sum up to 4 pi.
+		double ya = 1.0 - 2.0 * sh__blockEdge(j, t->step, t->ny, t->h) / t->h;
+		double yb = 1.0 - 2.0 * sh__blockEdge(j + 1, t->step, t->ny, t->h) / t->h;
+		for (int i = 0; i < t->nx; i++)
+		{
+			double xa = 2.0 * sh__blockEdge(i, t->step, t->nx, t->w) / t->w - 1.0;
+			double xb = 2.0 * sh__blockEdge(i + 1, t->step, t->nx, t->w) / t->w - 1.0;
+			double area = sh__areaElement(xa, ya) - sh__areaElement(xa, yb) - sh__areaElement(xb, ya) + sh__areaElement(xb, yb);
+			il[i] = (float)(1.0 / sqrt((double)t->u[i] * t->u[i] + (double)t->v[j] * t->v[j] + 1.0));
+			weight[i] = (float)fabs(area);
+		}
+	}
+	else
+	{
+		for (int i = 0; i < t->nx; i++)
+		{
+			float l = sqrtf(t->u[i] * t->u[i] + t->v[j] * t->v[j] + 1.0f);
+			il[i] = 1.0f / l;
+			weight[i] = 1.0f / (l * l * l); // fast approximation of texelSolidAngle
+		}
+	}
+}
+
+static sh__table *sh__build_table(int w, int h, int step, sh_weighting weighting, int threads)
+{
+	sh__table *t = (sh__table*)calloc(1, sizeof(sh__table));
+	if (!t)
+		return 0;
+	t->w = w;
+	t->h = h;
+	t->step = step;
+	t->weighting = weighting;
+	t->nx = (w + step - 1) / step;
+	t->ny = (h + step - 1) / step;
+	t->stride = (t->nx + 7) & ~7;
+	t->u = (float*)calloc(t->stride, sizeof(float));
+	t->v = (float*)calloc(t->ny, sizeof(float));
+	t->il = (float*)calloc((size_t)t->ny * t->stride, sizeof(float));
+	t->weight = (float*)calloc((size_t)t->ny * t->stride, sizeof(float));
+	if (!t->u || !t->v || !t->il || !t->weight)
+	{
+		free(t->u); free(t->v); free(t->il); free(t->weight);
+		free(t);
+		return 0;
+	}
+
+	for (int i = 0; i < t->nx; i++)
+	{
+		int x = i * step;
+		if (weighting == SH_WEIGHT_EXACT) // center of the sampled texel
+			t->u[i] = 2.0f * (x + 0.5f) / w - 1.0f;
+		else
+			t->u[i] = 2.0f * (x / (w - 1.0f)) - 1.0f;
+	}
+	for (int j = 0; j < t->ny; j++)
+	{
+		int y = j * step;
+		if (weighting == SH_WEIGHT_EXACT)
+			t->v[j] = 1.0f - 2.0f * (y + 0.5f) / h;
+		else
+			t->v[j] = -2.0f * (y / (h - 1.0f)) + 1.0f;
+	}
+	sh_parallel_for(t->ny, threads, sh__build_table_row, t);
+	return t;
+}
+
+static void sh__free_table(sh__table *t)
+{
+	free(t->u); free(t->v); free(t->il); free(t->weight);
+	free(t);
+}
+
+// call with sh__tablesMutex held
+static sh__table *sh__find_table(int w, int h, int step, sh_weighting weighting)
+{
+	for (size_t i = 0; i < sh__tables.size(); i++)
+	{
+		sh__table *t = sh__tables[i];
+		if (t->w == w && t->h == h && t->step == step && t->weighting == weighting)
+			return t;
+	}
+	return 0;
+}
+
+const sh__table *sh__get_table(int w, int h, int step, sh_weighting weighting, int threads)
+{
+	{
+		std::unique_lock<std::mutex> lock(sh__tablesMutex);
+		sh__table *t = sh__find_table(w, h, step, weighting);
+		if (t)
+			return t;
+	}
+
+	// built without the lock: sh_parallel_for waits for the pool, whose tasks may be in here as well
+	sh__table *t = sh__build_table(w, h, step, weighting, threads);
+	if (!t)
+		return 0;
+	std::unique_lock<std::mutex> lock(sh__tablesMutex);
+	sh__table *other = sh__find_table(w, h, step, weighting);
+	if (other) // another thread was faster
+	{
+		sh__free_table(t);
+		return other;
+	}
+	sh__tables.push_back(t);
+	return t;
+}
+
+static void sh__free_latlong_table(sh__latlong_table *t)
+{
+	free(t->sinPhi); free(t->cosPhi); free(t->colWeight);
+	free(t->sinTheta); free(t->cosTheta); free(t->rowWeight);
+	free(t);
+}
+
+static sh__latlong_table *sh__build_latlong_table(int w, int h, int step, sh_weighting weighting)
+{
+	sh__latlong_table *t = (sh__latlong_table*)calloc(1, sizeof(sh__latlong_table));
+	if (!t)
+		return 0;
+	t->w = w;
+	t->h = h;
+	t->step = step;
+	t->weighting = weighting;
+	t->nx = (w + step - 1) / step;
+	t->ny = (h + step - 1) / step;
+	t->stride = (t->nx + 7) & ~7;
+	t->sinPhi = (float*)calloc(t->stride, sizeof(float));
+	t->cosPhi = (float*)calloc(t->stride, sizeof(float));
+	t->colWeight = (float*)calloc(t->stride, sizeof(float));
+	t->sinTheta = (float*)calloc(t->ny, sizeof(float));
+	t->cosTheta = (float*)calloc(t->ny, sizeof(float));
+	t->rowWeight = (float*)calloc(t->ny, sizeof(float));
+	if (!t->sinPhi || !t->cosPhi || !t->colWeight || !t->sinTheta || !t->cosTheta || !t->rowWeight)
+	{
+		sh__free_latlong_table(t);
+		return 0;
+	}
+
+	// samples sit at texel centers. exact weights integrate the solid angle
+	// sin(theta) dtheta dphi over the texels closer to a sample than to its
+	// neighbours, the approximation uses sin(theta) at the sample.
+	const double pi = 3.14159265358979323846;
+	for (int i = 0; i < t->nx; i++)
+	{
+		double phi = 2.0 * pi * (i * step + 0.5) / w - pi;
+		t->sinPhi[i] = (float)sin(phi);
+		t->cosPhi[i] = (float)cos(phi);
+		if (weighting == SH_WEIGHT_EXACT)
+			t->colWeight[i] = (float)(2.0 * pi * (sh__blockEdge(i + 1, step, t->nx, w) - sh__blockEdge(i, step, t->nx, w)) / w);
+		else
+			t->colWeight[i] = (float)(2.0 * pi * step / w);
+	}
+	for (int j = 0; j < t->ny; j++)
+	{
+		double theta = pi * (j * step + 0.5) / h;
+		t->sinTheta[j] = (float)sin(theta);
+		t->cosTheta[j] = (float)cos(theta);
+		if (weighting == SH_WEIGHT_EXACT)
+			t->rowWeight[j] = (float)(cos(pi * sh__blockEdge(j, step, t->ny, h) / h) - cos(pi * sh__blockEdge(j + 1, step, t->ny, h) / h));
+		else
+			t->rowWeight[j] = (float)(sin(theta) * pi * step / h);
+	}
+	return t;
+}
+
+const sh__latlong_table *sh__get_latlong_table(int w, int h, int step, sh_weighting weighting)
+{
+	std::unique_lock<std::mutex> lock(sh__tablesMutex);
+	for (size_t i = 0; i < sh__latlongTables.size(); i++)
+	{
+		sh__latlong_table *t = sh__latlongTables[i];
+		if (t->w == w && t->h == h && t->step == step && t->weighting == weighting)
+			return t;
+	}
+	sh__latlong_table *t = sh__build_latlong_table(w, h, step, weighting);
+	if (t)
+		sh__latlongTables.push_back(t);
+	return t;
+}
+
+void sh_free_tables(void)
+{
+	std::unique_lock<std::mutex> lock(sh__tablesMutex);
+	for (size_t i = 0; i < sh__tables.size(); i++)
+		sh__free_table(sh__tables[i]);
+	sh__tables.clear();
+	for (size_t i = 0; i < sh__latlongTables.size(); i++)
+		sh__free_latlong_table(sh__latlongTables[i]);
+	sh__latlongTables.clear();
+}
@@ -442,6 +442,29 @@ STBIDEF stbi_uc *stbi_load_from_file  (FILE *f,                  int *x, int *y,
 // for stbi_load_from_file, file pointer is left pointing immediately after image
 #endif
 
+// like stbi_load, but JPEGs are decoded at 1/2^scale_log2 size (0..3) using
+// only the low frequency DCT coefficients of each 8x8 block, so every output
+// pixel is roughly the average of the 2^scale_log2 squared pixels it covers.
+// other formats are loaded at full size; *x and *y report the actual size.
+STBIDEF stbi_uc *stbi_load_from_memory_scaled(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp, int scale_log2);
+#ifndef STBI_NO_STDIO
+STBIDEF stbi_uc *stbi_load_scaled        (char const *filename,                     int *x, int *y, int *comp, int req_comp, int scale_log2);
+#endif
+
+// row by row decoding: nothing is returned, every row of w * req_comp values
+// (stbi_uc, or float for stbi_loadf_rows) is handed to cb in top to bottom
+// order and is only valid during the call. baseline JPEGs (scaled like
+// stbi_load_scaled) and Radiance .hdr files keep only a few rows in memory,
+// everything else is decoded whole first. rows are never flipped.
+// returns 1 on success.
+typedef void (*stbi_row_callback)(void *user, const void *row, int y, int w, int h);
+#ifndef STBI_NO_STDIO
+STBIDEF int stbi_load_rows (char const *filename, int *x, int *y, int *comp, int req_comp, int scale_log2, stbi_row_callback cb, void *user);
+#ifndef STBI_NO_LINEAR
+STBIDEF int stbi_loadf_rows(char const *filename, int *x, int *y, int *comp, int req_comp, stbi_row_callback cb, void *user);
+#endif
+#endif
+
 #ifndef STBI_NO_LINEAR
    STBIDEF float *stbi_loadf                 (char const *filename,           int *x, int *y, int *comp, int req_comp);
    STBIDEF float *stbi_loadf_from_memory     (stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp);
@@ -759,6 +782,10 @@ typedef struct
 
    stbi_uc *img_buffer, *img_buffer_end;
    stbi_uc *img_buffer_original, *img_buffer_original_end;
+
+   int jpeg_scale_log2; // reduced size jpeg decode, see stbi_load_scaled
+   stbi_row_callback row_callback; // != NULL: rows are handed out, see stbi_load_rows
+   void *row_user;
 } stbi__context;
 
 
@@ -771,6 +798,8 @@ static void stbi__start_mem(stbi__context *s, stbi_uc const *buffer, int len)
    s->read_from_callbacks = 0;
    s->img_buffer = s->img_buffer_original = (stbi_uc *) buffer;
    s->img_buffer_end = s->img_buffer_original_end = (stbi_uc *) buffer+len;
+   s->jpeg_scale_log2 = 0;
+   s->row_callback = NULL;
 }
 
 // initialize a callback-based context
@@ -783,6 +812,8 @@ static void stbi__start_callbacks(stbi__context *s, stbi_io_callbacks *c, void *
    s->img_buffer_original = s->buffer_start;
    stbi__refill_buffer(s);
    s->img_buffer_original_end = s->img_buffer_end;
+   s->jpeg_scale_log2 = 0;
+   s->row_callback = NULL;
 }
 
 #ifndef STBI_NO_STDIO
@@ -1048,6 +1079,55 @@ STBIDEF stbi_uc *stbi_load(char const *filename, int *x, int *y, int *comp, int
    return result;
 }
 
+STBIDEF stbi_uc *stbi_load_scaled(char const *filename, int *x, int *y, int *comp, int req_comp, int scale_log2)
+{
+   FILE *f = stbi__fopen(filename, "rb");
+   unsigned char *result;
+   stbi__context s;
+   if (!f) return stbi__errpuc("can't fopen", "Unable to open file");
+   if (scale_log2 < 0 || scale_log2 > 3) { fclose(f); return stbi__errpuc("bad scale", "Internal error"); }
+   stbi__start_file(&s,f);
+   s.jpeg_scale_log2 = scale_log2;
+   result = stbi__load_flip(&s,x,y,comp,req_comp);
+   fclose(f);
+   return result;
+}
+
+static void stbi__emit_rows(const void *data, int w, int h, size_t row_bytes, stbi_row_callback cb, void *user)
+{
+   int j;
+   for (j=0; j < h; ++j)
+      cb(user, (const stbi_uc *) data + row_bytes * j, j, w, h);
+}
+
+STBIDEF int stbi_load_rows(char const *filename, int *x, int *y, int *comp, int req_comp, int scale_log2, stbi_row_callback cb, void *user)
+{
+   FILE *f = stbi__fopen(filename, "rb");
+   unsigned char *result;
+   stbi__context s;
+   if (!f) return stbi__err("can't fopen", "Unable to open file");
+   if (scale_log2 < 0 || scale_log2 > 3) { fclose(f); return stbi__err("bad scale", "Internal error"); }
+   if (req_comp < 1 || req_comp > 4) { fclose(f); return stbi__err("bad req_comp", "Internal error"); }
+   stbi__start_file(&s,f);
+   s.jpeg_scale_log2 = scale_log2;
+   #ifndef STBI_NO_JPEG
+   if (stbi__jpeg_test(&s)) {
+      s.row_callback = cb;
+      s.row_user = user;
+      result = stbi__jpeg_load(&s,x,y,comp,req_comp); // the row buffer
+      fclose(f);
+      STBI_FREE(result);
+      return result != NULL;
+   }
+   #endif
+   result = stbi__load_main(&s,x,y,comp,req_comp);
+   fclose(f);
+   if (!result) return 0;
+   stbi__emit_rows(result, *x, *y, (size_t) *x * req_comp, cb, user);
+   STBI_FREE(result);
+   return 1;
+}
+
 STBIDEF stbi_uc *stbi_load_from_file(FILE *f, int *x, int *y, int *comp, int req_comp)
 {
    unsigned char *result;
@@ -1069,6 +1149,15 @@ STBIDEF stbi_uc *stbi_load_from_memory(stbi_uc const *buffer, int len, int *x, i
    return stbi__load_flip(&s,x,y,comp,req_comp);
 }
 
+STBIDEF stbi_uc *stbi_load_from_memory_scaled(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp, int scale_log2)
+{
+   stbi__context s;
+   if (scale_log2 < 0 || scale_log2 > 3) return stbi__errpuc("bad scale", "Internal error");
+   stbi__start_mem(&s,buffer,len);
+   s.jpeg_scale_log2 = scale_log2;
+   return stbi__load_flip(&s,x,y,comp,req_comp);
+}
+
 STBIDEF stbi_uc *stbi_load_from_callbacks(stbi_io_callbacks const *clbk, void *user, int *x, int *y, int *comp, int req_comp)
 {
    stbi__context s;
@@ -1119,6 +1208,32 @@ STBIDEF float *stbi_loadf(char const *filename, int *x, int *y, int *comp, int r
    return result;
 }
 
+STBIDEF int stbi_loadf_rows(char const *filename, int *x, int *y, int *comp, int req_comp, stbi_row_callback cb, void *user)
+{
+   FILE *f = stbi__fopen(filename, "rb");
+   float *result;
+   stbi__context s;
+   if (!f) return stbi__err("can't fopen", "Unable to open file");
+   if (req_comp < 1 || req_comp > 4) { fclose(f); return stbi__err("bad req_comp", "Internal error"); }
+   stbi__start_file(&s,f);
+   #ifndef STBI_NO_HDR
+   if (stbi__hdr_test(&s)) {
+      s.row_callback = cb;
+      s.row_user = user;
+      result = stbi__hdr_load(&s,x,y,comp,req_comp); // the row buffer
+      fclose(f);
+      STBI_FREE(result);
+      return result != NULL;
+   }
+   #endif
+   result = stbi__loadf_main(&s,x,y,comp,req_comp);
+   fclose(f);
+   if (!result) return 0;
+   stbi__emit_rows(result, *x, *y, (size_t) *x * req_comp * sizeof(float), cb, user);
+   STBI_FREE(result);
+   return 1;
+}
+
 STBIDEF float *stbi_loadf_from_file(FILE *f, int *x, int *y, int *comp, int req_comp)
 {
    stbi__context s;
@@ -1488,7 +1603,8 @@ typedef struct
       int hd,ha;
       int dc_pred;
 
-      int x,y,w2,h2;
+      int x,y,w2,h2; // w2,h2 are the (possibly reduced) sizes of data
+      int ring_h;    // rows of data, h2 or a ring of a few MCU rows when streaming
       stbi_uc *data;
       void *raw_data, *raw_coeff;
       stbi_uc *linebuf;
@@ -1511,6 +1627,8 @@ typedef struct
 
    int scan_n, order[4];
    int restart_interval, todo;
+   int scale_log2; // each 8x8 block is decoded to (8>>scale_log2)^2 pixels
+   struct stbi__jpeg_output *out; // color conversion state, see load_jpeg_image
 
 // kernels
    void (*idct_block_kernel)(stbi_uc *out, int out_stride, short data[64]);
@@ -2025,6 +2143,64 @@ static void stbi__idct_block(stbi_uc *out, int out_stride, short data[64])
    }
 }
 
+// reduced size IDCTs for stbi_load_scaled. an N point IDCT of the top left NxN
+// coefficients gives the block at 1/(8/N) size; each pixel is approximately
+// the average of the (8/N)^2 full size pixels it covers.
+
+// 4 point 1D IDCT times 2, inputs and outputs in fixed point
+#define STBI__IDCT_1D_4(s0,s1,s2,s3) \
+   int e0 = ((s0) + (s2)) * stbi__f2f(0.7071067812f); \
+   int e1 = ((s0) - (s2)) * stbi__f2f(0.7071067812f); \
+   int o0 = (s1) * stbi__f2f(0.9238795325f) + (s3) * stbi__f2f(0.3826834324f); \
+   int o1 = (s1) * stbi__f2f(0.3826834324f) - (s3) * stbi__f2f(0.9238795325f);
+
+static void stbi__idct_block_4x4(stbi_uc *out, int out_stride, short data[64])
+{
+   int i,val[16],*v=val;
+   short *d = data;
+
+   // columns, keep 2 extra bits of precision
+   for (i=0; i < 4; ++i,++d,++v) {
+      STBI__IDCT_1D_4(d[0],d[8],d[16],d[24])
+      e0 += 512; e1 += 512;
+      v[ 0] = (e0+o0) >> 10;
+      v[12] = (e0-o0) >> 10;
+      v[ 4] = (e1+o1) >> 10;
+      v[ 8] = (e1-o1) >> 10;
+   }
+
+   // rows; 1<<12 from the constants, 1<<2 from the first pass and a
+   // factor of 4 from both doubled 1D IDCTs are removed by the shift
+   for (i=0, v=val; i < 4; ++i,v+=4,out+=out_stride) {
+      STBI__IDCT_1D_4(v[0],v[1],v[2],v[3])
+      e0 += 32768 + (128<<16);
+      e1 += 32768 + (128<<16);
+      out[0] = stbi__clamp((e0+o0) >> 16);
+      out[3] = stbi__clamp((e0-o0) >> 16);
+      out[1] = stbi__clamp((e1+o1) >> 16);
+      out[2] = stbi__clamp((e1-o1) >> 16);
+   }
+}
+
+static void stbi__idct_block_2x2(stbi_uc *out, int out_stride, short data[64])
+{
+   // the 2 point IDCT is just a sum and a difference, scaled by 1/8 in 2D
+   int t0 = data[0] + data[1], t1 = data[0] - data[1];
+   int s0 = data[8] + data[9], s1 = data[8] - data[9];
+   int bias = 4 + (128<<3);
+   out[0]            = stbi__clamp((t0+s0+bias) >> 3);
+   out[1]            = stbi__clamp((t1+s1+bias) >> 3);
+   out[out_stride]   = stbi__clamp((t0-s0+bias) >> 3);
+   out[out_stride+1] = stbi__clamp((t1-s1+bias) >> 3);
+}
+
+static void stbi__idct_block_1x1(stbi_uc *out, int out_stride, short data[64])
+{
+   // block average from the DC coefficient alone
+   STBI_NOTUSED(out_stride);
+   out[0] = stbi__clamp((data[0] + 4 + (128<<3)) >> 3);
+}
+
 #ifdef STBI_SSE2
 // sse2 integer IDCT. not the fastest possible implementation but it
 // produces bit-identical results to the generic C version so it's
@@ -2448,6 +2624,9 @@ static void stbi__jpeg_reset(stbi__jpeg *j)
    // since we don't even allow 1<<30 pixels
 }
 
+// hands out the rows completed by MCU row j when streaming, see load_jpeg_image
+static void stbi__jpeg_stream_mcu_row(stbi__jpeg *z, int j);
+
 static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
 {
    stbi__jpeg_reset(z);
@@ -2466,7 +2645,7 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
             for (i=0; i < w; ++i) {
                int ha = z->img_comp[n].ha;
                if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               z->idct_block_kernel(z->img_comp[n].data+((z->img_comp[n].w2*j*8+i*8)>>z->scale_log2), z->img_comp[n].w2, data);
                // every data block is an MCU, so countdown the restart interval
                if (--z->todo <= 0) {
                   if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
@@ -2493,8 +2672,10 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
                         int x2 = (i*z->img_comp[n].h + x)*8;
                         int y2 = (j*z->img_comp[n].v + y)*8;
                         int ha = z->img_comp[n].ha;
+                        // data is a ring of ring_h rows when streaming, else ring_h == h2
+                        int row = (y2 >> z->scale_log2) % z->img_comp[n].ring_h;
                         if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-                        z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
+                        z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*row+(x2>>z->scale_log2), z->img_comp[n].w2, data);
                      }
                   }
                }
@@ -2506,6 +2687,7 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
                   stbi__jpeg_reset(z);
                }
             }
+            if (z->out) stbi__jpeg_stream_mcu_row(z, j);
          }
          return 1;
       }
@@ -2591,7 +2773,7 @@ static void stbi__jpeg_finish(stbi__jpeg *z)
             for (i=0; i < w; ++i) {
                short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
                stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               z->idct_block_kernel(z->img_comp[n].data+((z->img_comp[n].w2*j*8+i*8)>>z->scale_log2), z->img_comp[n].w2, data);
             }
          }
       }
@@ -2701,6 +2883,24 @@ static int stbi__process_scan_header(stbi__jpeg *z)
    return 1;
 }
 
+static int stbi__jpeg_alloc_planes(stbi__jpeg *z)
+{
+   int i;
+   for (i=0; i < z->s->img_n; ++i) {
+      z->img_comp[i].raw_data = stbi__malloc(z->img_comp[i].w2 * z->img_comp[i].ring_h+15);
+      if (z->img_comp[i].raw_data == NULL) {
+         for(--i; i >= 0; --i) {
+            STBI_FREE(z->img_comp[i].raw_data);
+            z->img_comp[i].raw_data = NULL;
+         }
+         return stbi__err("outofmem", "Out of memory");
+      }
+      // align blocks for idct using mmx/sse
+      z->img_comp[i].data = (stbi_uc*) (((size_t) z->img_comp[i].raw_data + 15) & ~15);
+   }
+   return 1;
+}
+
 static int stbi__process_frame_header(stbi__jpeg *z, int scan)
 {
    stbi__context *s = z->s;
@@ -2761,23 +2961,14 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       // the bogus oversized data from using interleaved MCUs and their
       // big blocks (e.g. a 16x16 iMCU on an image of width 33); we won't
       // discard the extra data until colorspace conversion
-      z->img_comp[i].w2 = z->img_mcu_x * z->img_comp[i].h * 8;
-      z->img_comp[i].h2 = z->img_mcu_y * z->img_comp[i].v * 8;
-      z->img_comp[i].raw_data = stbi__malloc(z->img_comp[i].w2 * z->img_comp[i].h2+15);
-
-      if (z->img_comp[i].raw_data == NULL) {
-         for(--i; i >= 0; --i) {
-            STBI_FREE(z->img_comp[i].raw_data);
-            z->img_comp[i].raw_data = NULL;
-         }
-         return stbi__err("outofmem", "Out of memory");
-      }
-      // align blocks for idct using mmx/sse
-      z->img_comp[i].data = (stbi_uc*) (((size_t) z->img_comp[i].raw_data + 15) & ~15);
+      z->img_comp[i].w2 = (z->img_mcu_x * z->img_comp[i].h * 8) >> z->scale_log2;
+      z->img_comp[i].h2 = (z->img_mcu_y * z->img_comp[i].v * 8) >> z->scale_log2;
+      z->img_comp[i].ring_h = z->img_comp[i].h2;
+      z->img_comp[i].raw_data = NULL;
       z->img_comp[i].linebuf = NULL;
       if (z->progressive) {
-         z->img_comp[i].coeff_w = (z->img_comp[i].w2 + 7) >> 3;
-         z->img_comp[i].coeff_h = (z->img_comp[i].h2 + 7) >> 3;
+         z->img_comp[i].coeff_w = z->img_mcu_x * z->img_comp[i].h;
+         z->img_comp[i].coeff_h = z->img_mcu_y * z->img_comp[i].v;
          z->img_comp[i].raw_coeff = STBI_MALLOC(z->img_comp[i].coeff_w * z->img_comp[i].coeff_h * 64 * sizeof(short) + 15);
          z->img_comp[i].coeff = (short*) (((size_t) z->img_comp[i].raw_coeff + 15) & ~15);
       } else {
@@ -2786,7 +2977,10 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       }
    }
 
-   return 1;
+   // streamed baseline images get their planes at the first scan, once it
+   // is known whether all components are interleaved
+   if (s->row_callback && !z->progressive) return 1;
+   return stbi__jpeg_alloc_planes(z);
 }
 
 // use comparisons since in some cases we handle more than one case (e.g. SOF)
@@ -2821,6 +3015,8 @@ static int stbi__decode_jpeg_header(stbi__jpeg *z, int scan)
 }
 
 // decode image to YCbCr format
+static int stbi__jpeg_stream_begin(stbi__jpeg *z);
+
 static int stbi__decode_jpeg_image(stbi__jpeg *j)
 {
    int m;
@@ -2834,6 +3030,7 @@ static int stbi__decode_jpeg_image(stbi__jpeg *j)
    while (!stbi__EOI(m)) {
       if (stbi__SOS(m)) {
          if (!stbi__process_scan_header(j)) return 0;
+         if (!j->img_comp[0].raw_data && !stbi__jpeg_stream_begin(j)) return 0;
          if (!stbi__parse_entropy_coded_data(j)) return 0;
          if (j->marker == STBI__MARKER_none ) {
             // handle 0s at the end of image data from IP Kamera 9060
@@ -3262,6 +3459,8 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
+   j->scale_log2 = 0;
+   j->out = NULL;
    j->idct_block_kernel = stbi__idct_block;
    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_row;
    j->resample_row_hv_2_kernel = stbi__resample_row_hv_2;
@@ -3317,111 +3516,190 @@ typedef struct
    int ypos;    // which pre-expansion row we're on
 } stbi__resample;
 
-static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
+// color conversion state, set up once the final image size is known
+typedef struct stbi__jpeg_output
 {
-   int n, decode_n;
-   z->s->img_n = 0; // make stbi__cleanup_jpeg safe
+   stbi__resample res_comp[4];
+   int n, decode_n, req_comp;
+   int ready;
+   stbi__uint32 y;  // next output row
+   stbi_uc *row;    // one output row when streaming
+} stbi__jpeg_output;
 
-   // validate req_comp
-   if (req_comp < 0 || req_comp > 4) return stbi__errpuc("bad req_comp", "Internal error");
+static int stbi__jpeg_output_init(stbi__jpeg *z, stbi__jpeg_output *o)
+{
+   int k;
 
-   // load a jpeg image from whichever source, but leave in YCbCr format
-   if (!stbi__decode_jpeg_image(z)) { stbi__cleanup_jpeg(z); return NULL; }
+   // from here on everything works on the reduced size image
+   if (z->scale_log2) {
+      int round = (1 << z->scale_log2) - 1;
+      z->s->img_x = (z->s->img_x + round) >> z->scale_log2;
+      z->s->img_y = (z->s->img_y + round) >> z->scale_log2;
+      for (k=0; k < z->s->img_n; ++k) {
+         z->img_comp[k].x = (z->img_comp[k].x + round) >> z->scale_log2;
+         z->img_comp[k].y = (z->img_comp[k].y + round) >> z->scale_log2;
+      }
+   }
 
    // determine actual number of components to generate
-   n = req_comp ? req_comp : z->s->img_n;
+   o->n = o->req_comp ? o->req_comp : z->s->img_n;
 
-   if (z->s->img_n == 3 && n < 3)
-      decode_n = 1;
+   if (z->s->img_n == 3 && o->n < 3)
+      o->decode_n = 1;
    else
-      decode_n = z->s->img_n;
+      o->decode_n = z->s->img_n;
 
-   // resample and color-convert
-   {
-      int k;
-      unsigned int i,j;
-      stbi_uc *output;
-      stbi_uc *coutput[4];
-
-      stbi__resample res_comp[4];
-
-      for (k=0; k < decode_n; ++k) {
-         stbi__resample *r = &res_comp[k];
-
-         // allocate line buffer big enough for upsampling off the edges
-         // with upsample factor of 4
-         z->img_comp[k].linebuf = (stbi_uc *) stbi__malloc(z->s->img_x + 3);
-         if (!z->img_comp[k].linebuf) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
-
-         r->hs      = z->img_h_max / z->img_comp[k].h;
-         r->vs      = z->img_v_max / z->img_comp[k].v;
-         r->ystep   = r->vs >> 1;
-         r->w_lores = (z->s->img_x + r->hs-1) / r->hs;
-         r->ypos    = 0;
-         r->line0   = r->line1 = z->img_comp[k].data;
-
-         if      (r->hs == 1 && r->vs == 1) r->resample = resample_row_1;
-         else if (r->hs == 1 && r->vs == 2) r->resample = stbi__resample_row_v_2;
-         else if (r->hs == 2 && r->vs == 1) r->resample = stbi__resample_row_h_2;
-         else if (r->hs == 2 && r->vs == 2) r->resample = z->resample_row_hv_2_kernel;
-         else                               r->resample = stbi__resample_row_generic;
-      }
+   for (k=0; k < o->decode_n; ++k) {
+      stbi__resample *r = &o->res_comp[k];
 
-      // can't error after this so, this is safe
-      output = (stbi_uc *) stbi__malloc(n * z->s->img_x * z->s->img_y + 1);
-      if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
+      // allocate line buffer big enough for upsampling off the edges
+      // with upsample factor of 4
+      z->img_comp[k].linebuf = (stbi_uc *) stbi__malloc(z->s->img_x + 3);
+      if (!z->img_comp[k].linebuf) return stbi__err("outofmem", "Out of memory");
+
+      r->hs      = z->img_h_max / z->img_comp[k].h;
+      r->vs      = z->img_v_max / z->img_comp[k].v;
+      r->ystep   = r->vs >> 1;
+      r->w_lores = (z->s->img_x + r->hs-1) / r->hs;
+      r->ypos    = 0;
+      r->line0   = r->line1 = z->img_comp[k].data;
+
+      if      (r->hs == 1 && r->vs == 1) r->resample = resample_row_1;
+      else if (r->hs == 1 && r->vs == 2) r->resample = stbi__resample_row_v_2;
+      else if (r->hs == 2 && r->vs == 1) r->resample = stbi__resample_row_h_2;
+      else if (r->hs == 2 && r->vs == 2) r->resample = z->resample_row_hv_2_kernel;
+      else                               r->resample = stbi__resample_row_generic;
+   }
+
+   if (z->s->row_callback) {
+      o->row = (stbi_uc *) stbi__malloc(o->n * z->s->img_x + 1);
+      if (!o->row) return stbi__err("outofmem", "Out of memory");
+   }
+   o->y = 0;
+   o->ready = 1;
+   return 1;
+}
 
-      // now go ahead and resample
-      for (j=0; j < z->s->img_y; ++j) {
-         stbi_uc *out = output + n * z->s->img_x * j;
-         for (k=0; k < decode_n; ++k) {
-            stbi__resample *r = &res_comp[k];
-            int y_bot = r->ystep >= (r->vs >> 1);
-            coutput[k] = r->resample(z->img_comp[k].linebuf,
-                                     y_bot ? r->line1 : r->line0,
-                                     y_bot ? r->line0 : r->line1,
-                                     r->w_lores, r->hs);
-            if (++r->ystep >= r->vs) {
-               r->ystep = 0;
-               r->line0 = r->line1;
-               if (++r->ypos < z->img_comp[k].y)
-                  r->line1 += z->img_comp[k].w2;
+// resamples and color-converts the rows up to end into output, or hands
+// them to the row callback one by one if output is NULL
+static void stbi__jpeg_output_rows(stbi__jpeg *z, stbi__jpeg_output *o, stbi_uc *output, stbi__uint32 end)
+{
+   int k, n = o->n;
+   unsigned int i,j;
+   stbi_uc *coutput[4];
+
+   for (j=o->y; j < end; ++j) {
+      stbi_uc *out = output ? output + n * z->s->img_x * j : o->row;
+      for (k=0; k < o->decode_n; ++k) {
+         stbi__resample *r = &o->res_comp[k];
+         int y_bot = r->ystep >= (r->vs >> 1);
+         coutput[k] = r->resample(z->img_comp[k].linebuf,
+                                  y_bot ? r->line1 : r->line0,
+                                  y_bot ? r->line0 : r->line1,
+                                  r->w_lores, r->hs);
+         if (++r->ystep >= r->vs) {
+            r->ystep = 0;
+            r->line0 = r->line1;
+            if (++r->ypos < z->img_comp[k].y) {
+               r->line1 += z->img_comp[k].w2;
+               if (r->line1 == z->img_comp[k].data + z->img_comp[k].w2 * z->img_comp[k].ring_h)
+                  r->line1 = z->img_comp[k].data; // streaming ring wraps around
             }
          }
-         if (n >= 3) {
-            stbi_uc *y = coutput[0];
-            if (z->s->img_n == 3) {
-               if (z->rgb == 3) {
-                  for (i=0; i < z->s->img_x; ++i) {
-                     out[0] = y[i];
-                     out[1] = coutput[1][i];
-                     out[2] = coutput[2][i];
-                     out[3] = 255;
-                     out += n;
-                  }
-               } else {
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-               }
-            } else
+      }
+      if (n >= 3) {
+         stbi_uc *y = coutput[0];
+         if (z->s->img_n == 3) {
+            if (z->rgb == 3) {
                for (i=0; i < z->s->img_x; ++i) {
-                  out[0] = out[1] = out[2] = y[i];
-                  out[3] = 255; // not used if n==3
+                  out[0] = y[i];
+                  out[1] = coutput[1][i];
+                  out[2] = coutput[2][i];
+                  out[3] = 255;
                   out += n;
                }
-         } else {
-            stbi_uc *y = coutput[0];
-            if (n == 1)
-               for (i=0; i < z->s->img_x; ++i) out[i] = y[i];
-            else
-               for (i=0; i < z->s->img_x; ++i) *out++ = y[i], *out++ = 255;
-         }
+            } else {
+               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+            }
+         } else
+            for (i=0; i < z->s->img_x; ++i) {
+               out[0] = out[1] = out[2] = y[i];
+               out[3] = 255; // not used if n==3
+               out += n;
+            }
+      } else {
+         stbi_uc *y = coutput[0];
+         if (n == 1)
+            for (i=0; i < z->s->img_x; ++i) out[i] = y[i];
+         else
+            for (i=0; i < z->s->img_x; ++i) *out++ = y[i], *out++ = 255;
       }
+      if (!output)
+         z->s->row_callback(z->s->row_user, o->row, j, z->s->img_x, z->s->img_y);
+   }
+   o->y = end;
+}
+
+// streaming keeps a ring of 3 MCU rows per component instead of whole
+// planes. that only works if a single scan interleaves all components;
+// other files are decoded whole and handed out row by row at the end.
+static int stbi__jpeg_stream_begin(stbi__jpeg *z)
+{
+   int i;
+   if (z->progressive || z->scan_n != z->s->img_n || z->scan_n < 2)
+      return stbi__jpeg_alloc_planes(z);
+   for (i=0; i < z->s->img_n; ++i) {
+      int mcu_rows = (z->img_comp[i].v * 8) >> z->scale_log2;
+      z->img_comp[i].ring_h = 3 * mcu_rows < z->img_comp[i].h2 ? 3 * mcu_rows : z->img_comp[i].h2;
+   }
+   if (!stbi__jpeg_alloc_planes(z)) return 0;
+   return stbi__jpeg_output_init(z, z->out);
+}
+
+static void stbi__jpeg_stream_mcu_row(stbi__jpeg *z, int j)
+{
+   // output row y needs component rows up to about y / vs + 1, so the rows
+   // above MCU row j are complete, while MCU row j - 2 may be overwritten next
+   stbi__uint32 end = (stbi__uint32) j * (z->img_mcu_h >> z->scale_log2);
+   if (!z->out->ready) return;
+   stbi__jpeg_output_rows(z, z->out, NULL, end < z->s->img_y ? end : z->s->img_y);
+}
+
+// in row callback mode, returns the (already handed out) row buffer on success
+static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
+{
+   stbi__jpeg_output o;
+   stbi_uc *output = NULL;
+   z->s->img_n = 0; // make stbi__cleanup_jpeg safe
+
+   // validate req_comp
+   if (req_comp < 0 || req_comp > 4) return stbi__errpuc("bad req_comp", "Internal error");
+
+   memset(&o, 0, sizeof(o));
+   o.req_comp = req_comp;
+   z->out = &o;
+
+   // load a jpeg image from whichever source, but leave in YCbCr format
+   // (unless it was already handed out while streaming)
+   if (!stbi__decode_jpeg_image(z) || (!o.ready && !stbi__jpeg_output_init(z, &o))) {
       stbi__cleanup_jpeg(z);
-      *out_x = z->s->img_x;
-      *out_y = z->s->img_y;
-      if (comp) *comp  = z->s->img_n; // report original components, not output
-      return output;
+      STBI_FREE(o.row);
+      return NULL;
+   }
+
+   if (!z->s->row_callback) {
+      // can't error after this so, this is safe
+      output = (stbi_uc *) stbi__malloc(o.n * z->s->img_x * z->s->img_y + 1);
+      if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
    }
+
+   // now go ahead and resample (the rest of a streamed image)
+   stbi__jpeg_output_rows(z, &o, output, z->s->img_y);
+   stbi__cleanup_jpeg(z);
+   *out_x = z->s->img_x;
+   *out_y = z->s->img_y;
+   if (comp) *comp  = z->s->img_n; // report original components, not output
+   return output ? output : o.row;
 }
 
 static unsigned char *stbi__jpeg_load(stbi__context *s, int *x, int *y, int *comp, int req_comp)
@@ -3430,6 +3708,12 @@ static unsigned char *stbi__jpeg_load(stbi__context *s, int *x, int *y, int *com
    stbi__jpeg* j = (stbi__jpeg*) stbi__malloc(sizeof(stbi__jpeg));
    j->s = s;
    stbi__setup_jpeg(j);
+   if (s->jpeg_scale_log2) {
+      static void (*const scaled[4])(stbi_uc *out, int out_stride, short data[64]) =
+         { stbi__idct_block, stbi__idct_block_4x4, stbi__idct_block_2x2, stbi__idct_block_1x1 };
+      j->scale_log2 = s->jpeg_scale_log2;
+      j->idct_block_kernel = scaled[j->scale_log2];
+   }
    result = load_jpeg_image(j, x,y,comp,req_comp);
    STBI_FREE(j);
    return result;
@@ -6147,6 +6431,7 @@ static float *stbi__hdr_load(stbi__context *s, int *x, int *y, int *comp, int re
    int len;
    unsigned char count, value;
    int i, j, k, c1,c2, z;
+   int row_stride; // floats between rows of hdr_data, 0 when streaming a single row
 
 
    // Check identifier
@@ -6180,7 +6465,8 @@ static float *stbi__hdr_load(stbi__context *s, int *x, int *y, int *comp, int re
    if (req_comp == 0) req_comp = 3;
 
    // Read data
-   hdr_data = (float *) stbi__malloc(height * width * req_comp * sizeof(float));
+   row_stride = s->row_callback ? 0 : width * req_comp;
+   hdr_data = (float *) stbi__malloc((s->row_callback ? 1 : height) * width * req_comp * sizeof(float));
 
    // Load image data
    // image data is stored as some number of sca
@@ -6191,8 +6477,9 @@ static float *stbi__hdr_load(stbi__context *s, int *x, int *y, int *comp, int re
             stbi_uc rgbe[4];
            main_decode_loop:
             stbi__getn(s, rgbe, 4);
-            stbi__hdr_convert(hdr_data + j * width * req_comp + i * req_comp, rgbe, req_comp);
+            stbi__hdr_convert(hdr_data + j * row_stride + i * req_comp, rgbe, req_comp);
          }
+         if (s->row_callback) s->row_callback(s->row_user, hdr_data, j, width, height);
       }
    } else {
       // Read RLE-encoded data
@@ -6239,7 +6526,8 @@ static float *stbi__hdr_load(stbi__context *s, int *x, int *y, int *comp, int re
             }
          }
          for (i=0; i < width; ++i)
-            stbi__hdr_convert(hdr_data+(j*width + i)*req_comp, scanline + i*4, req_comp);
+            stbi__hdr_convert(hdr_data + j * row_stride + i * req_comp, scanline + i*4, req_comp);
+         if (s->row_callback) s->row_callback(s->row_user, hdr_data, j, width, height);
       }
       STBI_FREE(scanline);
    }
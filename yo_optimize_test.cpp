@@ -0,0 +1,144 @@
+/***********************************************************
+* Test for yo_optimize_mesh: a shuffled grid larger than   *
+* one block has to get close to Tipsify on the whole mesh  *
+* no warranty implied | use at your own risk               *
+* author: Andreas Mantler (ands) | last change: 17.10.2026 *
+*                                                          *
+* License:                                                 *
+* This software is in the public domain.                   *
+* Where that dedication is not recognized,                 *
+* you are granted a perpetual, irrevocable license to copy *
+* and modify this file however you want.                   *
+***********************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C"
+{
+	#define YO_NOIMG
+	#include "yocto_obj.h"
+}
+#include "sh_pool.h"
+
+// n x n quads as triangles in random order, vertex ids shuffled as well
+static yo_mesh *shuffledGrid(int n, unsigned int seed)
+{
+	int nverts = (n + 1) * (n + 1);
+	int ntriangles = n * n * 2;
+	yo_mesh *mesh = (yo_mesh*)calloc(1, sizeof(yo_mesh));
+	mesh->nverts = nverts;
+	mesh->ntriangles = ntriangles;
+	mesh->index_size = nverts <= 65536 ? 2 : 4;
+	mesh->size = sizeof(float) * 6 * nverts;
+	mesh->pos = (float*)calloc(mesh->size + (size_t)ntriangles * 3 * mesh->index_size, 1);
+	mesh->norm = mesh->pos + 3 * nverts;
+	mesh->indices = (char*)mesh->pos + mesh->size;
+
+	int *vid = (int*)malloc(sizeof(int) * nverts);
+	int *tris = (int*)malloc(sizeof(int) * 3 * ntriangles);
+	for (int i = 0; i < nverts; i++)
+		vid[i] = i;
+	for (int i = nverts - 1; i > 0; i--)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		int j = (int)((seed >> 8) % (unsigned int)(i + 1)), t = vid[i];
+		vid[i] = vid[j]; vid[j] = t;
+	}
+	for (int y = 0; y <= n; y++)
+	{
+		for (int x = 0; x <= n; x++)
+		{
+			float *p = mesh->pos + 3 * vid[y * (n + 1) + x];
+			p[0] = (float)x; p[1] = (float)y;
+			mesh->norm[3 * vid[y * (n + 1) + x] + 2] = 1.0f;
+		}
+	}
+	for (int y = 0, t = 0; y < n; y++)
+	{
+		for (int x = 0; x < n; x++, t += 2)
+		{
+			int a = vid[y * (n + 1) + x], b = vid[y * (n + 1) + x + 1];
+			int c = vid[(y + 1) * (n + 1) + x], d = vid[(y + 1) * (n + 1) + x + 1];
+			int *q = tris + 3 * t;
+			q[0] = a; q[1] = b; q[2] = d;
+			q[3] = a; q[4] = d; q[5] = c;
+		}
+	}
+	for (int i = ntriangles - 1; i > 0; i--)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		int j = (int)((seed >> 8) % (unsigned int)(i + 1));
+		for (int k = 0; k < 3; k++)
+		{
+			int t = tris[3 * i + k];
+			tris[3 * i + k] = tris[3 * j + k];
+			tris[3 * j + k] = t;
+		}
+	}
+	for (int i = 0; i < ntriangles * 3; i++)
+	{
+		if (mesh->index_size == 2)
+			((unsigned short*)mesh->indices)[i] = (unsigned short)tris[i];
+		else
+			((int*)mesh->indices)[i] = tris[i];
+	}
+	free(vid);
+	free(tris);
+	return mesh;
+}
+
+// ACMR of Tipsify over all triangles in one block, in file order
+static float wholeMeshACMR(const yo_mesh *mesh, int cacheSize)
+{
+	yo__mesh_optimizer opt;
+	memset(&opt, 0, sizeof(opt));
+	int nindices = mesh->ntriangles * 3;
+	int *indices = (int*)malloc(sizeof(int) * nindices);
+	for (int i = 0; i < nindices; i++)
+		indices[i] = yo_mesh_index(mesh, i);
+	opt.indices = indices;
+	opt.output = (int*)malloc(sizeof(int) * nindices);
+	opt.clusters = (unsigned char*)malloc(mesh->ntriangles);
+	opt.ntriangles = mesh->ntriangles;
+	opt.cache_size = cacheSize;
+	opt.block = mesh->ntriangles;
+	yo__tipsify_block(&opt, 0);
+
+	yo_mesh whole = *mesh;
+	whole.index_size = 4;
+	whole.indices = opt.output;
+	float acmr = (float)yo_mesh_transforms(&whole, cacheSize) / mesh->ntriangles;
+	free(indices);
+	free(opt.output);
+	free(opt.clusters);
+	return acmr;
+}
+
+static void parallelFor(int count, void (*task)(void *user, int index), void *user)
+{
+	sh_parallel_for(count, 0, task, user);
+}
+
+int main()
+{
+	const int cacheSize = 32;
+	int failed = 0;
+	for (int overdraw = 0; overdraw < 2; overdraw++)
+	{
+		yo_mesh *mesh = shuffledGrid(300, 1);
+		float before = (float)yo_mesh_transforms(mesh, cacheSize) / mesh->ntriangles;
+		float whole = wholeMeshACMR(mesh, cacheSize);
+		yo_optimize_mesh(mesh, cacheSize, overdraw != 0, parallelFor);
+		float after = (float)yo_mesh_transforms(mesh, cacheSize) / mesh->ntriangles;
+
+		// blocks may cost a little at their borders and the overdraw sort a little more
+		int ok = after <= whole * 1.15f;
+		printf("shuffled 300 x 300 grid (%d triangles, overdraw %d): ACMR %.3f -> %.3f, whole mesh Tipsify %.3f: %s\n",
+			mesh->ntriangles, overdraw, before, after, whole, ok ? "ok" : "FAILED");
+		failed += !ok;
+		yo_free_mesh(mesh);
+	}
+	return failed ? 1 : 0;
+}
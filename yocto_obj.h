@@ -82,6 +82,18 @@
 //    archival but as a speed up to avoid ASCII serializatiion/deserialization
 //
 
+//
+// USAGE FOR MESH CACHES:
+//
+// 1. for viewers that only draw triangles, merge a scene into vertex and
+//    index buffer images with mesh = yo_make_mesh(scene) and store them next
+//    to the OBJ with yo_save_mesh(cache_filename, mesh, obj_filename)
+// 2. later runs map them with mesh = yo_load_mesh(cache_filename,
+//    obj_filename), which fails if the OBJ changed, and copy mesh->pos
+//    (mesh->size bytes) and mesh->indices straight into the buffers; release
+//    the mesh with yo_free_mesh(mesh)
+//
+
 //
 // COMPILATION:
 //
@@ -90,12 +102,15 @@
 // - to use as a .h, just #define YO_NOINLINE before including this file
 // - to use as a .c, just #define YO_IMPLEMENTATION before including this file
 // To disable texture loading code, #define YO_NOIMG (uses stb_image.h to load).
-// Internal yocto_obj uses a fixed size hash table to resolve unique vertices
-// in OBJ. Use YO_HASHSIZE to change the number of bucks.
+// Internal yocto_obj resolves unique vertices in OBJ with a hash table sized
+// from the number of faces.
 //
 
 //
 // HISTORY:
+// - v 0.4: mapped binary mesh caches
+// - v 0.3: open addressing vertex hash sized from the faces
+// - v 0.2: memory mapped, chunked parallel parsing without the locale
 // - v 0.1: handles larger files but allocates more up front memory
 // - v 0.0: initial release
 
@@ -137,6 +152,7 @@
 #endif
 
 #include <stdbool.h>
+#include <stddef.h>
 
 // -----------------------------------------------------------------------------
 // INTERFACE
@@ -288,6 +304,32 @@ typedef struct yo_scene {
 YO_API yo_scene*
 yo_load_obj(const char* filename, bool triangulate, bool ext);
 
+//
+// Parallel loop for yo_load_obj_mt: runs task(user, i) for every i in
+// [0, count), on any thread and in any order, and returns when all are done.
+//
+typedef void (*yo_parallel_for)(int count, void (*task)(void* user, int index),
+                                void* user);
+
+//
+// Loads a scene from disk like yo_load_obj (which is this function without
+// parallel_for). The file is memory mapped and split into newline aligned
+// chunks that are parsed with parallel_for (serially if NULL), numbers are
+// parsed without the locale.
+//
+// Parameters:
+// - filename: scene filename
+// - truangulate: whether to triagulate on load (fan-style)
+// - ext: enable extensions
+// - parallel_for: parallel loop or NULL
+//
+// Returns:
+// - loaded scene or NULL for error
+//
+YO_API yo_scene*
+yo_load_obj_mt(const char* filename, bool triangulate, bool ext,
+               yo_parallel_for parallel_for);
+
 //
 // Loads a binary scene dump from disk
 //
@@ -329,6 +371,110 @@ yo_save_obj(const char* filename, const yo_scene* scene, bool ext);
 YO_API bool
 yo_save_objbin(const char* filename, const yo_scene* scene, bool ext);
 
+//
+// GPU ready indexed triangle mesh: the unique vertices of all triangle shapes
+// as a block of positions followed by a block of normals, which is exactly
+// the content of a vertex buffer, and the triangles as 16 bit indices if
+// there are at most 65536 vertices, 32 bit ones otherwise. Meshes loaded
+// from a cache file point into the read only file mapping.
+//
+typedef struct yo_mesh {
+    int nverts;      // number of vertices
+    int ntriangles;  // number of triangles
+    float* pos;      // vertex positions [nverts][3]
+    float* norm;     // vertex normals [nverts][3], right after pos
+    size_t size;     // bytes from pos to the end of norm
+    void* indices;   // triangles [ntriangles][3] (unsigned short or int)
+    int index_size;  // bytes per index (2 or 4)
+    void* _file;     // [private] file mapping, NULL if the mesh owns memory
+} yo_mesh;
+
+//
+// Merges the triangle shapes of a scene into a mesh (missing normals are
+// zero).
+//
+// Parameters:
+// - scene: scene with triangle shapes
+//
+// Returns:
+// - mesh, free with yo_free_mesh
+//
+YO_API yo_mesh*
+yo_make_mesh(const yo_scene* scene);
+
+//
+// Saves a mesh cache: a small header and the vertex buffer contents. The size
+// and modification time of source are stored with it, so yo_load_mesh can
+// tell stale caches.
+//
+// Parameters:
+// - filename: cache filename
+// - mesh: mesh to save
+// - source: file the mesh was made from or NULL
+//
+// Returns:
+// - true if ok
+//
+YO_API bool
+yo_save_mesh(const char* filename, const yo_mesh* mesh, const char* source);
+
+//
+// Index of a mesh.
+//
+YO_API int
+yo_mesh_index(const yo_mesh* mesh, int i);
+
+//
+// Vertex shader invocations of drawing a mesh through a FIFO post transform
+// cache, or per triangle corner for cache_size 0 (as in non indexed drawing).
+//
+// Parameters:
+// - mesh: mesh to draw
+// - cache_size: entries of the cache or 0
+//
+// Returns:
+// - number of transformed vertices
+//
+YO_API int
+yo_mesh_transforms(const yo_mesh* mesh, int cache_size);
+
+//
+// Reorders the triangles of a mesh for the post transform vertex cache
+// (Tipsify), optionally sorts clusters of them to reduce overdraw, and then
+// numbers the vertices in the order of first use for vertex fetch. The
+// triangles are sorted by the Morton code of their centroids and reordered in
+// blocks of 65536 with parallel_for, so big meshes in any face order get
+// compact blocks; the result does not depend on the number of threads.
+//
+// Parameters:
+// - mesh: mesh made with yo_make_mesh (mapped caches are left as they are)
+// - cache_size: entries of the targeted vertex cache
+// - overdraw: draw triangle clusters facing away from the center first
+// - parallel_for: parallel loop or NULL
+//
+YO_API void
+yo_optimize_mesh(yo_mesh* mesh, int cache_size, bool overdraw,
+                 yo_parallel_for parallel_for);
+
+//
+// Maps a mesh cache without parsing or copying anything.
+//
+// Parameters:
+// - filename: cache filename
+// - source: file the cache has to match (size and modification time) or NULL
+//
+// Returns:
+// - mesh or NULL if missing, invalid or stale
+//
+YO_API yo_mesh*
+yo_load_mesh(const char* filename, const char* source);
+
+//
+// Free a mesh and unmap its cache file.
+//
+YO_API void
+yo_free_mesh(yo_mesh* mesh);
+
 //
 // Free scene data.
 //
@@ -358,12 +504,29 @@ yo_load_textures(yo_scene* scene, const char* filename, int req_comp);
 #include <assert.h>
 #include <ctype.h>
 #include <limits.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
 // -----------------------------------------------------------------------------
 // LOW-LEVEL SUPPORT FOR FIXED VECTORS AND GROWABLE ARRAYS
 // -----------------------------------------------------------------------------
@@ -406,16 +569,143 @@ typedef struct { float m[16]; } yo__mat4f;
 typedef struct { int pos, texcoord, norm, color, radius, vid; } yo__vert;
 
 //
-// Vertex hash table to avoid duplicating vertices.
+// Vertex hash table to avoid duplicating vertices. Open addressing with
+// linear probing over 64 bit keys: vertices without color and radius pack
+// (pos, texcoord, norm) into the key exactly, 21 bits each; all others get
+// a hashed key with the top bit set and are compared in full. The table
+// starts at twice the expected vertex count, grows at half load and is
+// cleared in time proportional to the vertices of the shape.
 //
-#define yo__vhash_size 1048576
+typedef struct yo__vslot {
+    unsigned long long key;  // packed or hashed vertex
+    int vid;                 // vertex index, -1 if empty
+} yo__vslot;
+
 typedef struct yo__vhash {
-    int nverts;                   // numner of vertices
-    int s[yo__vhash_size];        // size of the hash buckets
-    yo__vert* v[yo__vhash_size];  // bucket data (one vertex for
-                                  // each unique face index)
+    int nverts;        // numner of vertices
+    int nslots;        // number of slots (power of two)
+    int shift;         // 64 - log2(nslots)
+    yo__vslot* slots;  // hash slots
+    yo__vert* verts;   // vertices by vid
+    int* used;         // slot of every vid
+    int maxverts;      // capacity of verts and used
 } yo__vhash;
 
+static inline void
+yo__alloc_vslots(yo__vhash* vhash, int nslots) {
+    vhash->nslots = nslots;
+    vhash->shift = 64;
+    while (nslots > 1) {
+        vhash->shift--;
+        nslots /= 2;
+    }
+    vhash->slots =
+        (yo__vslot*)malloc(sizeof(yo__vslot) * (size_t)vhash->nslots);
+    memset(vhash->slots, 0xff, sizeof(yo__vslot) * (size_t)vhash->nslots);
+}
+
+//
+// Initializes the hash for the given number of elements, which bounds the
+// unique vertices of typical meshes from above.
+//
+static inline void
+yo__init_vhash(yo__vhash* vhash, int nelems) {
+    memset(vhash, 0, sizeof(*vhash));
+    int nslots = 1024;
+    while (nslots < (1 << 30) && nslots < 2 * nelems) nslots *= 2;
+    yo__alloc_vslots(vhash, nslots);
+}
+
+static inline void
+yo__free_vhash(yo__vhash* vhash) {
+    free(vhash->slots);
+    free(vhash->verts);
+    free(vhash->used);
+    memset(vhash, 0, sizeof(*vhash));
+}
+
+// forget all vertices
+static inline void
+yo__clear_vhash(yo__vhash* vhash) {
+    for (int i = 0; i < vhash->nverts; i++) vhash->slots[vhash->used[i]].vid = -1;
+    vhash->nverts = 0;
+}
+
+static inline unsigned long long
+yo__vhash_key(yo__vert v) {
+    const unsigned int m = (1u << 21) - 1;
+    unsigned int p = v.pos + 1, t = v.texcoord + 1, n = v.norm + 1;
+    if (v.color < 0 && v.radius < 0 && p <= m && t <= m && n <= m)
+        return (unsigned long long)p << 42 | (unsigned long long)t << 21 | n;
+    int f[5] = { v.pos, v.texcoord, v.norm, v.color, v.radius };
+    unsigned long long h = 0;
+    for (int i = 0; i < 5; i++) {
+        h = (h ^ (unsigned int)f[i]) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    }
+    return h | (1ull << 63);
+}
+
+// first slot of a key
+static inline int
+yo__vhash_slot(const yo__vhash* vhash, unsigned long long key) {
+    return (int)((key * 0x9e3779b97f4a7c15ull) >> vhash->shift);
+}
+
+// doubles the slots and inserts all vertices again
+static inline void
+yo__grow_vhash(yo__vhash* vhash) {
+    free(vhash->slots);
+    yo__alloc_vslots(vhash, vhash->nslots * 2);
+    int mask = vhash->nslots - 1;
+    for (int vid = 0; vid < vhash->nverts; vid++) {
+        unsigned long long key = yo__vhash_key(vhash->verts[vid]);
+        int s = yo__vhash_slot(vhash, key);
+        while (vhash->slots[s].vid >= 0) s = (s + 1) & mask;
+        vhash->slots[s].key = key;
+        vhash->slots[s].vid = vid;
+        vhash->used[vid] = s;
+    }
+}
+
+// finds the unique vertex of an OBJ vertex reference or inserts it with the
+// next vid
+static inline yo__vert
+yo__find_vert(yo__vhash* vhash, yo__vert v) {
+    if (2 * (vhash->nverts + 1) > vhash->nslots) yo__grow_vhash(vhash);
+
+    // probe until the vertex or an empty slot
+    unsigned long long key = yo__vhash_key(v);
+    int mask = vhash->nslots - 1;
+    int s = yo__vhash_slot(vhash, key);
+    for (;; s = (s + 1) & mask) {
+        yo__vslot* slot = vhash->slots + s;
+        if (slot->vid < 0) break;
+        if (slot->key != key) continue;
+        yo__vert* found = vhash->verts + slot->vid;
+        if (!(key >> 63) ||
+            (v.pos == found->pos && v.texcoord == found->texcoord &&
+             v.norm == found->norm && v.color == found->color &&
+             v.radius == found->radius))
+            return *found;
+    }
+
+    // insert in vhash
+    if (vhash->nverts == vhash->maxverts) {
+        vhash->maxverts = vhash->maxverts ? 2 * vhash->maxverts : 1024;
+        vhash->verts = (yo__vert*)realloc(
+            vhash->verts, sizeof(yo__vert) * (size_t)vhash->maxverts);
+        vhash->used =
+            (int*)realloc(vhash->used, sizeof(int) * (size_t)vhash->maxverts);
+    }
+    v.vid = vhash->nverts++;
+    vhash->slots[s].key = key;
+    vhash->slots[s].vid = v.vid;
+    vhash->verts[v.vid] = v;
+    vhash->used[v.vid] = s;
+    return v;
+}
+
 //
 // Round up to next power of two to use with growable arrays without
 // keeping the capicity explicitly.
@@ -607,8 +897,7 @@ yo__flush_shape(yo_scene* scene, yo__vhash* vhash) {
     }
 
     // clear buffers
-    vhash->nverts = 0;
-    for (int i = 0; i < yo__vhash_size; i++) vhash->s[i] = 0;
+    yo__clear_vhash(vhash);
 
     // get a new shape
     yo__vector_grow(yo_shape, scene->shapes, scene->nshapes, 1);
@@ -666,8 +955,7 @@ yo__add_camera(yo_scene* scene, const char* name, yo__vert from, yo__vert to,
     cam->aperture = (from.texcoord >= 0) ? texcoord[from.texcoord].x : 0;
 
     // clear buffers
-    vhash->nverts = 0;
-    for (int i = 0; i < yo__vhash_size; i++) vhash->s[i] = 0;
+    yo__clear_vhash(vhash);
 }
 
 //
@@ -688,84 +976,95 @@ yo__add_env(yo_scene* scene, const char* name, const char* matname,
         (from.norm >= 0) ? norm[from.norm] : yo__v3(0, 1, 0);
 
     // clear buffers
-    vhash->nverts = 0;
-    for (int i = 0; i < yo__vhash_size; i++) vhash->s[i] = 0;
-}
-
-// parses one float
-static inline float
-yo__parse_float(char** tok) {
-    return (float)atof(tok[0]);
+    yo__clear_vhash(vhash);
 }
 
-// parses two floats
-static inline yo__vec2f
-yo__parse_float2(char** tok) {
-    return yo__v2((float)atof(tok[0]), (float)atof(tok[1]));
-}
-
-// parses three floats
-static inline yo__vec3f
-yo__parse_float3(char** tok) {
-    return yo__v3((float)atof(tok[0]), (float)atof(tok[1]),
-                        (float)atof(tok[2]));
-}
-
-// parses 16 floats
-static inline yo__mat4f
-yo__parse_mat4f(char** tok) {
-    yo__mat4f m = { { 0 } };
-    for (int i = 0; i < 16; i++) m.m[i] = (float)atof(tok[i]);
-    return m;
+//
+// Locale independent number parsing on [*str, end), no terminating zero
+// needed. Up to 19 significant digits are gathered in an integer and scaled
+// by an exact power of ten, which rounds like strtod for the usual OBJ
+// numbers. Advances *str past the number.
+//
+static inline bool
+yo__isdigit(char c) {
+    return (unsigned)(c - '0') < 10;
 }
 
-// parses an OBJ vertex triplet (or quintuplet with extensions); handle
-// nagative indices directly
-static inline yo__vert
-yo__parse_vert(char* str, yo__vhash* vhash, yo__vert vl) {
-    // parse triplet
-    char* splits[] = { str, 0, 0, 0, 0 };
-    int ns = 1;
-    yo__vert v = { -1, -1, -1, -1, -1 };
-    while (*str) {
-        if (*str == '/') {
-            *str = 0;
-            if (ns < 5) splits[ns++] = str + 1;
+static inline float
+yo__parse_number(const char** str, const char* end) {
+    static const double pow10[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                    1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                    1e18, 1e19, 1e20, 1e21, 1e22 };
+    const char* s = *str;
+    bool neg = false;
+    if (s < end && (*s == '-' || *s == '+')) neg = *s++ == '-';
+    uint64_t mant = 0;
+    int exp = 0, ndigits = 0;
+    for (; s < end && yo__isdigit(*s); s++) {
+        if (ndigits < 19) {
+            mant = mant * 10 + (*s - '0');
+            ndigits += mant != 0;
+        } else
+            exp++;
+    }
+    if (s < end && *s == '.') {
+        for (s++; s < end && yo__isdigit(*s); s++) {
+            if (ndigits < 19) {
+                mant = mant * 10 + (*s - '0');
+                ndigits += mant != 0;
+                exp--;
+            }
         }
-        str++;
     }
-    int* f = &v.pos;
-    int* l = &vl.pos;
-    for (int i = 0; i < 5; i++) {
-        if (!splits[i]) {
-            f[i] = -1;
-            continue;
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char* e = s + 1;
+        bool eneg = false;
+        if (e < end && (*e == '-' || *e == '+')) eneg = *e++ == '-';
+        if (e < end && yo__isdigit(*e)) {
+            int ev = 0;
+            for (; e < end && yo__isdigit(*e); e++)
+                if (ev < 100000) ev = ev * 10 + (*e - '0');
+            exp += eneg ? -ev : ev;
+            s = e;
         }
-        f[i] = (int)atoi(splits[i]);
-        f[i] = (f[i] < 0) ? l[i] + f[i] : f[i] - 1;
     }
+    *str = s;
 
-    // determine position vid using vertex hash
-    int pos = -1;
-    int hidx = v.pos % yo__vhash_size;
-    for (int i = 0; i < vhash->s[hidx] && pos < 0; i++) {
-        if (v.pos == vhash->v[hidx][i].pos &&
-            v.texcoord == vhash->v[hidx][i].texcoord &&
-            v.norm == vhash->v[hidx][i].norm &&
-            v.color == vhash->v[hidx][i].color &&
-            v.radius == vhash->v[hidx][i].radius)
-            pos = i;
-    }
+    double v = (double)mant;  // exact below 2^53
+    while (exp > 22) v *= 1e22, exp -= 22;
+    while (exp < -22) v /= 1e22, exp += 22;
+    v = (exp < 0) ? v / pow10[-exp] : v * pow10[exp];
+    return (float)(neg ? -v : v);
+}
 
-    // found, can exit
-    if (pos >= 0) return vhash->v[hidx][pos];
+static inline int
+yo__parse_int(const char** str, const char* end) {
+    const char* s = *str;
+    bool neg = false;
+    if (s < end && (*s == '-' || *s == '+')) neg = *s++ == '-';
+    int v = 0;
+    for (; s < end && yo__isdigit(*s); s++) v = v * 10 + (*s - '0');
+    *str = s;
+    return neg ? -v : v;
+}
 
-    // insert in vhash
-    v.vid = vhash->nverts;
-    yo__pushback(yo__vert, vhash->v[hidx], vhash->s[hidx], v);
-    vhash->nverts++;
+// atof replacement for zero terminated tokens
+static inline float
+yo__atof(const char* str) {
+    return yo__parse_number(&str, str + strlen(str));
+}
 
-    return v;
+// parses one float
+static inline float
+yo__parse_float(char** tok) {
+    return yo__atof(tok[0]);
+}
+
+// parses three floats
+static inline yo__vec3f
+yo__parse_float3(char** tok) {
+    return yo__v3(yo__atof(tok[0]), yo__atof(tok[1]), yo__atof(tok[2]));
 }
 
 // add a unique vertex to a parsed shape
@@ -996,197 +1295,544 @@ yo__set_textures(yo_scene* scene) {
     }
 }
 
+// -----------------------------------------------------------------------------
+// MEMORY MAPPED FILES
+// -----------------------------------------------------------------------------
+
+//
+// Read only view of a whole file. Falls back to reading the file into memory
+// where mapping is not possible.
+//
+typedef struct yo__mapped_file {
+    const char* data;  // file contents (not zero terminated), NULL if empty
+    size_t size;       // file size in bytes
+    bool mapped;       // false if data is a malloc'd copy
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+} yo__mapped_file;
+
+static inline bool
+yo__map_file(const char* filename, yo__mapped_file* mf) {
+    memset(mf, 0, sizeof(*mf));
+#ifdef _WIN32
+    mf->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (mf->file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mf->file, &size)) {
+        CloseHandle(mf->file);
+        return false;
+    }
+    mf->size = (size_t)size.QuadPart;
+    if (mf->size) {
+        mf->mapping = CreateFileMappingA(mf->file, 0, PAGE_READONLY, 0, 0, 0);
+        if (mf->mapping)
+            mf->data = (const char*)MapViewOfFile(mf->mapping, FILE_MAP_READ,
+                                                  0, 0, 0);
+        mf->mapped = mf->data != 0;
+        if (!mf->mapped && mf->mapping) CloseHandle(mf->mapping);
+    }
+    if (!mf->mapped) CloseHandle(mf->file);
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st)) {
+        close(fd);
+        return false;
+    }
+    mf->size = (size_t)st.st_size;
+    if (mf->size) {
+        void* data = mmap(0, mf->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        mf->mapped = data != MAP_FAILED;
+        if (mf->mapped) mf->data = (const char*)data;
+    }
+    close(fd);  // the mapping stays valid
+#endif
+    if (mf->size && !mf->mapped) {
+        FILE* file = fopen(filename, "rb");
+        char* data = (char*)malloc(mf->size);
+        bool ok = file && data && fread(data, 1, mf->size, file) == mf->size;
+        if (file) fclose(file);
+        if (!ok) {
+            free(data);
+            return false;
+        }
+        mf->data = data;
+    }
+    return true;
+}
+
+static inline void
+yo__unmap_file(yo__mapped_file* mf) {
+    if (!mf->mapped) {
+        free((void*)mf->data);
+    } else {
+#ifdef _WIN32
+        UnmapViewOfFile(mf->data);
+        CloseHandle(mf->mapping);
+        CloseHandle(mf->file);
+#else
+        munmap((void*)mf->data, mf->size);
+#endif
+    }
+    memset(mf, 0, sizeof(*mf));
+}
+
+// -----------------------------------------------------------------------------
+// PARALLEL OBJ PARSING
+// -----------------------------------------------------------------------------
+
+//
+// The file is split into newline aligned chunks that are parsed in two
+// parallel passes. The first counts the vertex data lines of every chunk, so
+// prefix sums give each chunk the position of its values in the final
+// arrays. The second parses the values straight into place and turns all
+// other lines into a compact command stream per chunk; relative (negative)
+// indices resolve right away since the running counts are known. Shapes are
+// then built from the command streams in file order.
+//
+
+//
+// Line types, also the command codes of the command streams: elements are
+// [type, n, n x (pos, texcoord, norm, color, radius)], names are
+// [type, offset from the chunk start, length or -1] and transforms are
+// [type, 16 floats].
+//
+enum {
+    yo__line_none,
+    yo__line_v,
+    yo__line_vt,
+    yo__line_vn,
+    yo__line_f,
+    yo__line_l,
+    yo__line_p,
+    yo__line_o,
+    yo__line_g,
+    yo__line_usemtl,
+    yo__line_mtllib,
+    yo__line_vc,  // extensions from here on
+    yo__line_vr,
+    yo__line_xf,
+    yo__line_c,
+    yo__line_e,
+    yo__line_count
+};
+
+// values per vertex data line, in yo__vert order (pos, texcoord, norm, color,
+// radius)
+static const int yo__vert_dims[5] = { 3, 2, 3, 3, 1 };
+
+static inline int
+yo__vert_array(int type) {
+    switch (type) {
+        case yo__line_v: return 0;
+        case yo__line_vt: return 1;
+        case yo__line_vn: return 2;
+        case yo__line_vc: return 3;
+        case yo__line_vr: return 4;
+        default: return -1;
+    }
+}
+
+static inline bool
+yo__isws(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// skips whitespace, returns whether a token follows
+static inline bool
+yo__skip_ws(const char** s, const char* end) {
+    while (*s < end && yo__isws(**s)) (*s)++;
+    return *s < end;
+}
+
+// type of the line [*s, end), leaves *s after the keyword
+static inline int
+yo__line_type(const char** s, const char* end, bool ext) {
+    static const char* keywords[yo__line_count] = {
+        "", "v", "vt", "vn", "f", "l", "p", "o", "g", "usemtl", "mtllib",
+        "vc", "vr", "xf", "c", "e"
+    };
+    if (!yo__skip_ws(s, end)) return yo__line_none;
+    const char* tok = *s;
+    while (*s < end && !yo__isws(**s)) (*s)++;
+    size_t n = *s - tok;
+    int last = ext ? yo__line_count : yo__line_vc;
+    for (int t = 1; t < last; t++)
+        if (!strncmp(tok, keywords[t], n) && !keywords[t][n]) return t;
+    return yo__line_none;
+}
+
+typedef struct yo__obj_chunk {
+    const char* begin;  // first line
+    const char* end;    // after the last line
+    int count[5];       // vertex data lines per yo__vert_array
+    int base[5];        // vertex data lines in all previous chunks
+    int nelems;         // element lines
+    int* cmd;           // command stream
+    int ncmd, capacity;
+} yo__obj_chunk;
+
+typedef struct yo__obj_parser {
+    yo__obj_chunk* chunks;
+    bool ext;
+    float* data[5];  // vertex data of the whole file per yo__vert_array
+} yo__obj_parser;
+
+// appends n ints to the command stream
+static inline int*
+yo__push_cmd(yo__obj_chunk* chunk, int n) {
+    if (chunk->ncmd + n > chunk->capacity) {
+        chunk->capacity = 2 * chunk->capacity + n + 1024;
+        chunk->cmd = (int*)realloc(chunk->cmd, sizeof(int) * chunk->capacity);
+    }
+    chunk->ncmd += n;
+    return chunk->cmd + chunk->ncmd - n;
+}
+
+static inline void
+yo__count_chunk(void* user, int index) {
+    yo__obj_parser* parser = (yo__obj_parser*)user;
+    yo__obj_chunk* chunk = parser->chunks + index;
+    const char* line = chunk->begin;
+    while (line < chunk->end) {
+        const char* eol =
+            (const char*)memchr(line, '\n', chunk->end - line);
+        if (!eol) eol = chunk->end;
+        int a = yo__vert_array(yo__line_type(&line, eol, parser->ext));
+        if (a >= 0) chunk->count[a]++;
+        line = eol + 1;
+    }
+}
+
+static inline void
+yo__parse_chunk(void* user, int index) {
+    yo__obj_parser* parser = (yo__obj_parser*)user;
+    yo__obj_chunk* chunk = parser->chunks + index;
+    int count[5] = { 0 };
+    const char* line = chunk->begin;
+    while (line < chunk->end) {
+        const char* eol =
+            (const char*)memchr(line, '\n', chunk->end - line);
+        if (!eol) eol = chunk->end;
+        const char* s = line;
+        line = eol + 1;
+        int type = yo__line_type(&s, eol, parser->ext);
+        int a = yo__vert_array(type);
+        if (a >= 0) {
+            float* v = parser->data[a] +
+                       (size_t)(chunk->base[a] + count[a]++) * yo__vert_dims[a];
+            for (int i = 0; i < yo__vert_dims[a]; i++) {
+                yo__skip_ws(&s, eol);
+                v[i] = yo__parse_number(&s, eol);
+            }
+        } else if (type == yo__line_f || type == yo__line_l ||
+                   type == yo__line_p || type == yo__line_c ||
+                   type == yo__line_e) {
+            int start = chunk->ncmd, n = 0;
+            chunk->nelems++;
+            yo__push_cmd(chunk, 2);
+            while (yo__skip_ws(&s, eol)) {
+                // pos/texcoord/norm/color/radius, missing or 0 is -1
+                int* ref = yo__push_cmd(chunk, 5);
+                for (int i = 0; i < 5; i++) ref[i] = -1;
+                for (int i = 0; s < eol && !yo__isws(*s); i++) {
+                    const char* digits = s;
+                    int idx = yo__parse_int(&s, eol);
+                    if (s != digits && i < 5)
+                        ref[i] = (idx < 0) ? chunk->base[i] + count[i] + idx
+                                           : idx - 1;
+                    while (s < eol && !yo__isws(*s) && *s != '/') s++;
+                    if (s < eol && *s == '/') s++;
+                }
+                n++;
+            }
+            chunk->cmd[start] = type;
+            chunk->cmd[start + 1] = n;
+        } else if (type == yo__line_o || type == yo__line_g ||
+                   type == yo__line_usemtl || type == yo__line_mtllib) {
+            int* cmd = yo__push_cmd(chunk, 3);
+            cmd[0] = type;
+            cmd[1] = 0;
+            cmd[2] = -1;
+            if (yo__skip_ws(&s, eol)) {
+                const char* name = s;
+                while (s < eol && !yo__isws(*s)) s++;
+                cmd[1] = (int)(name - chunk->begin);
+                cmd[2] = (int)(s - name);
+            }
+        } else if (type == yo__line_xf) {
+            int* cmd = yo__push_cmd(chunk, 17);
+            cmd[0] = type;
+            for (int i = 0; i < 16; i++) {
+                yo__skip_ws(&s, eol);
+                float v = yo__parse_number(&s, eol);
+                memcpy(cmd + 1 + i, &v, sizeof(v));
+            }
+        }
+    }
+}
+
+static inline void
+yo__run_tasks(yo_parallel_for parallel_for, int count,
+              void (*task)(void* user, int index), void* user) {
+    if (parallel_for)
+        parallel_for(count, task, user);
+    else
+        for (int i = 0; i < count; i++) task(user, i);
+}
+
+// strdup of the first n chars, NULL for n < 0
+static inline char*
+yo__strndup(const char* str, int n) {
+    if (n < 0) return 0;
+    char* ret = (char*)calloc(n + 1, sizeof(char));
+    memcpy(ret, str, n);
+    return ret;
+}
+
+// unique vertex of the reference of a command stream element
+static inline yo__vert
+yo__cmd_vert(const int* ref, yo__vhash* vhash) {
+    yo__vert v = { ref[0], ref[1], ref[2], ref[3], ref[4], 0 };
+    return yo__find_vert(vhash, v);
+}
+
 //
 // Loads an OBJ file
 //
 YO_API yo_scene*
 yo_load_obj(const char* filename, bool triangulate, bool ext) {
+    return yo_load_obj_mt(filename, triangulate, ext, 0);
+}
+
+//
+// Loads an OBJ file, parsing chunks with parallel_for
+//
+YO_API yo_scene*
+yo_load_obj_mt(const char* filename, bool triangulate, bool ext,
+               yo_parallel_for parallel_for) {
+    // start
+    yo__mapped_file file;
+    if (!yo__map_file(filename, &file)) return 0;
+
+    // newline aligned chunks of about 256 KB, at most 4096 of them
+    size_t chunk_size = 1 << 18;
+    if (file.size / chunk_size >= 4096) chunk_size = file.size / 4096 + 1;
+    int nchunks = (int)((file.size + chunk_size - 1) / chunk_size);
+    yo__obj_parser parser;
+    memset(&parser, 0, sizeof(parser));
+    parser.ext = ext;
+    parser.chunks =
+        (yo__obj_chunk*)calloc(nchunks ? nchunks : 1, sizeof(yo__obj_chunk));
+    const char* file_end = file.data + file.size;
+    for (int c = 0; c < nchunks; c++) {
+        const char* begin = c ? parser.chunks[c - 1].end : file.data;
+        const char* end = file.data + (size_t)(c + 1) * chunk_size;
+        if (c == nchunks - 1 || end >= file_end) {
+            end = file_end;
+        } else if (end <= begin) {
+            end = begin;
+        } else {
+            const char* nl = (const char*)memchr(end - 1, '\n', file_end - end + 1);
+            end = nl ? nl + 1 : file_end;
+        }
+        parser.chunks[c].begin = begin;
+        parser.chunks[c].end = end;
+    }
+
+    // count, place and parse the vertex data
+    yo__run_tasks(parallel_for, nchunks, yo__count_chunk, &parser);
+    int total[5] = { 0 };
+    for (int c = 0; c < nchunks; c++) {
+        for (int a = 0; a < 5; a++) {
+            parser.chunks[c].base[a] = total[a];
+            total[a] += parser.chunks[c].count[a];
+        }
+    }
+    for (int a = 0; a < 5; a++)
+        if (total[a])
+            parser.data[a] = (float*)malloc(sizeof(float) * yo__vert_dims[a] *
+                                            (size_t)total[a]);
+    yo__run_tasks(parallel_for, nchunks, yo__parse_chunk, &parser);
+
     // prepare scene
     yo_scene* scene = yo__new(yo_scene);
 
     // vertex scene
-    yo__vert obj_nvert = { 0, 0, 0 };
-    yo__vec3f* obj_pos = 0;
-    yo__vec3f* obj_norm = 0;
-    yo__vec2f* obj_texcoord = 0;
-    yo__vec3f* obj_color = 0;
-    float* obj_radius = 0;
+    yo__vec3f* obj_pos = (yo__vec3f*)parser.data[0];
+    yo__vec2f* obj_texcoord = (yo__vec2f*)parser.data[1];
+    yo__vec3f* obj_norm = (yo__vec3f*)parser.data[2];
+    yo__vec3f* obj_color = (yo__vec3f*)parser.data[3];
+    float* obj_radius = parser.data[4];
 
     // current shape scene
-    yo__vhash* vhash = (yo__vhash*)calloc(1, sizeof(yo__vhash));
+    int nelems = 0;
+    for (int c = 0; c < nchunks; c++) nelems += parser.chunks[c].nelems;
+    yo__vhash vhash_;
+    yo__vhash* vhash = &vhash_;
+    yo__init_vhash(vhash, nelems);
     yo__vector_grow(yo_shape, scene->shapes, scene->nshapes, 1);
     yo_shape* shape = scene->shapes + scene->nshapes - 1;
 
-    // start
-    FILE* file = fopen(filename, "rt");
-    if (!file) return 0;
-
-    // foreach line, splits the line by whitespaces and parses the data
-    // directly in the current shape, emitting shapes when either name,
-    // material name, group name or shape element type changes
-    char line[4096];
-    char* tok[1024];
-    int linenum = 0;
-    while (fgets(line, 4096, file)) {
-        linenum += 1;
-        int ntok = yo__splitws(line, tok, 1024);
-
-        if (!ntok) {
-            continue;
-        } else if (tok[0][0] == '#') {
-            continue;
-        } else if (!strcmp(tok[0], "v")) {
-            yo__vec3f v = yo__parse_float3(tok + 1);
-            yo__pushback(yo__vec3f, obj_pos, obj_nvert.pos, v);
-        } else if (!strcmp(tok[0], "vt")) {
-            yo__vec2f v = yo__parse_float2(tok + 1);
-            yo__pushback(yo__vec2f, obj_texcoord, obj_nvert.texcoord, v);
-        } else if (!strcmp(tok[0], "vn")) {
-            yo__vec3f v = yo__parse_float3(tok + 1);
-            yo__pushback(yo__vec3f, obj_norm, obj_nvert.norm, v);
-        } else if (!strcmp(tok[0], "vc")) {
-            if (ext) {
-                yo__vec3f v = yo__parse_float3(tok + 1);
-                yo__pushback(yo__vec3f, obj_color, obj_nvert.color, v);
-            }
-        } else if (!strcmp(tok[0], "vr")) {
-            if (ext) {
-                float v = yo__parse_float(tok + 1);
-                yo__pushback(float, obj_radius, obj_nvert.radius, v);
-            }
-        } else if (!strcmp(tok[0], "xf")) {
-            if (ext) {
-                yo__mat4f xf = yo__parse_mat4f(tok + 1);
+    // foreach command, parses the data directly in the current shape,
+    // emitting shapes when either name, material name, group name or shape
+    // element type changes
+    bool ok = true;
+    for (int c = 0; c < nchunks && ok; c++) {
+        yo__obj_chunk* chunk = parser.chunks + c;
+        for (int i = 0; i < chunk->ncmd && ok;) {
+            const int* cmd = chunk->cmd + i;
+            int type = cmd[0];
+            if (type == yo__line_xf) {
+                i += 17;
                 shape->xform = (float*)calloc(16, sizeof(float));
-                *(yo__mat4f*)shape->xform = xf;
+                memcpy(shape->xform, cmd + 1, sizeof(float) * 16);
+                continue;
+            }
+            if (type == yo__line_o || type == yo__line_g ||
+                type == yo__line_usemtl || type == yo__line_mtllib) {
+                i += 3;
+                const char* name = chunk->begin + cmd[1];
+                int len = cmd[2];
+                if (type == yo__line_mtllib) {
+                    char mfilename[4096];
+                    yo__split_path(filename, mfilename, 0, 0);
+                    size_t dlen = strlen(mfilename);
+                    if (len < 0 || dlen + len >= sizeof(mfilename)) continue;
+                    memcpy(mfilename + dlen, name, len);
+                    mfilename[dlen + len] = 0;
+                    ok = yo__load_mtl(scene, mfilename) != 0;
+                    continue;
+                }
+                shape = yo__flush_shape(scene, vhash);
+                if (type == yo__line_o)
+                    shape->name = yo__strndup(name, len);
+                else if (type == yo__line_g)
+                    shape->groupname = yo__strndup(name, len);
+                else
+                    shape->matname = yo__strndup(name, len);
+                continue;
             }
-        } else if (!strcmp(tok[0], "c")) {
-            if (ext) {
+
+            // elements, tok[t] of the text line is ref + 5 * (t - 1)
+            int ntok = cmd[1] + 1;
+            const int* ref = cmd + 2;
+            i += 2 + 5 * cmd[1];
+            if (type == yo__line_c && ntok > 2) {
                 shape = yo__flush_shape(scene, vhash);
-                yo__vert from = yo__parse_vert(tok[1], vhash, obj_nvert);
-                yo__vert to = yo__parse_vert(tok[2], vhash, obj_nvert);
+                yo__vert from = yo__cmd_vert(ref, vhash);
+                yo__vert to = yo__cmd_vert(ref + 5, vhash);
                 yo__add_camera(scene, shape->name, from, to, obj_pos, obj_norm,
                                obj_texcoord, vhash);
                 shape->name = 0;
-            }
-        } else if (!strcmp(tok[0], "e")) {
-            if (ext) {
+            } else if (type == yo__line_e && ntok > 2) {
                 shape = yo__flush_shape(scene, vhash);
-                yo__vert from = yo__parse_vert(tok[1], vhash, obj_nvert);
-                yo__vert to = yo__parse_vert(tok[2], vhash, obj_nvert);
+                yo__vert from = yo__cmd_vert(ref, vhash);
+                yo__vert to = yo__cmd_vert(ref + 5, vhash);
                 yo__add_env(scene, shape->name, shape->matname, from, to,
                             obj_pos, obj_norm, vhash);
                 shape->name = 0;
                 shape->matname = 0;
-            }
-        } else if (!strcmp(tok[0], "f") && !triangulate) {
-            if (shape->etype != yo_etype_polygon) {
-                shape = yo__flush_shape(scene, vhash);
-            }
-            shape->etype = yo_etype_polygon;
-            yo__pushback(int, shape->elem, shape->nelems, ntok - 1);
-            for (int t = 1; t < ntok; t++) {
-                yo__vert v = yo__parse_vert(tok[t], vhash, obj_nvert);
-                yo__add_shape_vert(shape, v, obj_pos, obj_norm, obj_texcoord,
-                                   obj_color, obj_radius);
-                yo__pushback(int, shape->elem, shape->nelems, v.vid);
-            }
-        } else if (!strcmp(tok[0], "f") && triangulate) {
-            if (shape->etype != yo_etype_triangle) {
-                shape = yo__flush_shape(scene, vhash);
-            }
-            shape->etype = yo_etype_triangle;
-            int vi0 = 0;
-            for (int t = 1; t < ntok; t++) {
-                yo__vert v = yo__parse_vert(tok[t], vhash, obj_nvert);
-                yo__add_shape_vert(shape, v, obj_pos, obj_norm, obj_texcoord,
-                                   obj_color, obj_radius);
-                if (t == 1) vi0 = v.vid;
-                if (t > 3) {
-                    int vil = shape->elem[shape->nelems - 1];
-                    yo__pushback(int, shape->elem, shape->nelems, vi0);
-                    yo__pushback(int, shape->elem, shape->nelems, vil);
+            } else if (type == yo__line_f && !triangulate) {
+                if (shape->etype != yo_etype_polygon) {
+                    shape = yo__flush_shape(scene, vhash);
                 }
-                yo__pushback(int, shape->elem, shape->nelems, v.vid);
-            }
-        } else if (!strcmp(tok[0], "l") && !triangulate) {
-            if (shape->etype != yo_etype_polyline) {
-                shape = yo__flush_shape(scene, vhash);
-            }
-            shape->etype = yo_etype_polyline;
-            yo__pushback(int, shape->elem, shape->nelems, ntok - 1);
-            for (int t = 1; t < ntok; t++) {
-                yo__vert v = yo__parse_vert(tok[t], vhash, obj_nvert);
-                yo__add_shape_vert(shape, v, obj_pos, obj_norm, obj_texcoord,
-                                   obj_color, obj_radius);
-                yo__pushback(int, shape->elem, shape->nelems, v.vid);
-            }
-        } else if (!strcmp(tok[0], "l") && triangulate) {
-            if (shape->etype != yo_etype_line) {
-                shape = yo__flush_shape(scene, vhash);
-            }
-            shape->etype = yo_etype_line;
-            for (int t = 1; t < ntok; t++) {
-                yo__vert v = yo__parse_vert(tok[t], vhash, obj_nvert);
-                yo__add_shape_vert(shape, v, obj_pos, obj_norm, obj_texcoord,
-                                   obj_color, obj_radius);
-                if (t > 2) {
-                    int vil = shape->elem[shape->nelems - 1];
-                    yo__pushback(int, shape->elem, shape->nelems, vil);
+                shape->etype = yo_etype_polygon;
+                yo__pushback(int, shape->elem, shape->nelems, ntok - 1);
+                for (int t = 1; t < ntok; t++) {
+                    yo__vert v = yo__cmd_vert(ref + 5 * (t - 1), vhash);
+                    yo__add_shape_vert(shape, v, obj_pos, obj_norm,
+                                       obj_texcoord, obj_color, obj_radius);
+                    yo__pushback(int, shape->elem, shape->nelems, v.vid);
+                }
+            } else if (type == yo__line_f && triangulate) {
+                if (shape->etype != yo_etype_triangle) {
+                    shape = yo__flush_shape(scene, vhash);
+                }
+                shape->etype = yo_etype_triangle;
+                int vi0 = 0;
+                for (int t = 1; t < ntok; t++) {
+                    yo__vert v = yo__cmd_vert(ref + 5 * (t - 1), vhash);
+                    yo__add_shape_vert(shape, v, obj_pos, obj_norm,
+                                       obj_texcoord, obj_color, obj_radius);
+                    if (t == 1) vi0 = v.vid;
+                    if (t > 3) {
+                        int vil = shape->elem[shape->nelems - 1];
+                        yo__pushback(int, shape->elem, shape->nelems, vi0);
+                        yo__pushback(int, shape->elem, shape->nelems, vil);
+                    }
+                    yo__pushback(int, shape->elem, shape->nelems, v.vid);
+                }
+            } else if (type == yo__line_l && !triangulate) {
+                if (shape->etype != yo_etype_polyline) {
+                    shape = yo__flush_shape(scene, vhash);
+                }
+                shape->etype = yo_etype_polyline;
+                yo__pushback(int, shape->elem, shape->nelems, ntok - 1);
+                for (int t = 1; t < ntok; t++) {
+                    yo__vert v = yo__cmd_vert(ref + 5 * (t - 1), vhash);
+                    yo__add_shape_vert(shape, v, obj_pos, obj_norm,
+                                       obj_texcoord, obj_color, obj_radius);
+                    yo__pushback(int, shape->elem, shape->nelems, v.vid);
+                }
+            } else if (type == yo__line_l && triangulate) {
+                if (shape->etype != yo_etype_line) {
+                    shape = yo__flush_shape(scene, vhash);
+                }
+                shape->etype = yo_etype_line;
+                for (int t = 1; t < ntok; t++) {
+                    yo__vert v = yo__cmd_vert(ref + 5 * (t - 1), vhash);
+                    yo__add_shape_vert(shape, v, obj_pos, obj_norm,
+                                       obj_texcoord, obj_color, obj_radius);
+                    if (t > 2) {
+                        int vil = shape->elem[shape->nelems - 1];
+                        yo__pushback(int, shape->elem, shape->nelems, vil);
+                    }
+                    yo__pushback(int, shape->elem, shape->nelems, v.vid);
+                }
+            } else if (type == yo__line_p) {
+                if (shape->etype != yo_etype_point) {
+                    shape = yo__flush_shape(scene, vhash);
+                }
+                shape->etype = yo_etype_point;
+                for (int t = 1; t < ntok; t++) {
+                    yo__vert v = yo__cmd_vert(ref + 5 * (t - 1), vhash);
+                    yo__add_shape_vert(shape, v, obj_pos, obj_norm,
+                                       obj_texcoord, obj_color, obj_radius);
+                    yo__pushback(int, shape->elem, shape->nelems, v.vid);
                 }
-                yo__pushback(int, shape->elem, shape->nelems, v.vid);
-            }
-        } else if (!strcmp(tok[0], "p")) {
-            if (shape->etype != yo_etype_point) {
-                shape = yo__flush_shape(scene, vhash);
-            }
-            shape->etype = yo_etype_point;
-            for (int t = 1; t < ntok; t++) {
-                yo__vert v = yo__parse_vert(tok[t], vhash, obj_nvert);
-                yo__add_shape_vert(shape, v, obj_pos, obj_norm, obj_texcoord,
-                                   obj_color, obj_radius);
-                yo__pushback(int, shape->elem, shape->nelems, v.vid);
             }
-        } else if (!strcmp(tok[0], "o")) {
-            shape = yo__flush_shape(scene, vhash);
-            shape->name = yo__strdup((ntok > 1) ? tok[1] : 0);
-        } else if (!strcmp(tok[0], "g")) {
-            shape = yo__flush_shape(scene, vhash);
-            shape->groupname = yo__strdup((ntok > 1) ? tok[1] : 0);
-        } else if (!strcmp(tok[0], "usemtl")) {
-            shape = yo__flush_shape(scene, vhash);
-            shape->matname = yo__strdup((ntok > 1) ? tok[1] : 0);
-        } else if (!strcmp(tok[0], "mtllib")) {
-            char mfilename[4096];
-            yo__split_path(filename, mfilename, 0, 0);
-            strcat(mfilename, tok[1]);
-            if (!yo__load_mtl(scene, mfilename)) return 0;
-        } else {
-            // TODO: explicit skips
         }
     }
 
     // flush and cleanup empty shape if necessary
-    yo__flush_shape(scene, vhash);
-    scene->nshapes -= 1;
+    if (ok) {
+        yo__flush_shape(scene, vhash);
+        scene->nshapes -= 1;
+    }
 
     // close file
-    fclose(file);
+    for (int c = 0; c < nchunks; c++) free(parser.chunks[c].cmd);
+    free(parser.chunks);
+    yo__unmap_file(&file);
 
     // fix ids
-    yo__set_matids(scene);
-    yo__set_textures(scene);
+    if (ok) {
+        yo__set_matids(scene);
+        yo__set_textures(scene);
+    }
 
     // clear
-    for (int i = 0; i < yo__vhash_size; i++) {
-        if (vhash->v[i]) free(vhash->v[i]);
+    yo__free_vhash(vhash);
+    for (int a = 0; a < 5; a++) free(parser.data[a]);
+    if (!ok) {
+        yo_free_scene(scene);
+        free(scene);
+        return 0;
     }
-    free(vhash);
-    if (obj_pos) free(obj_pos);
-    if (obj_norm) free(obj_norm);
-    if (obj_texcoord) free(obj_texcoord);
-    if (obj_color) free(obj_color);
-    if (obj_radius) free(obj_radius);
 
     // trim data
     yo__trim(yo_camera, scene->cameras, scene->ncameras);
@@ -1498,7 +2144,7 @@ yo_load_objbin(const char* filename, bool ext) {
 
     int magic = 0;
     yo__fread_binintn(file, &magic, 1);
-    if (magic != yo__binmagic) return false;
+    if (magic != yo__binmagic) return 0;
 
     yo_scene* scene = (yo_scene*)calloc(1, sizeof(yo_scene));
 
@@ -1754,6 +2400,586 @@ yo_save_objbin(const char* filename, const yo_scene* scene, bool ext) {
     return true;
 }
 
+// -----------------------------------------------------------------------------
+// MESH CACHE
+// -----------------------------------------------------------------------------
+
+#define yo__meshmagic 0x6873656d  // "mesh"
+#define yo__meshversion 3
+
+//
+// Mesh cache header, followed by the vertex buffer contents and the indices.
+// 8 byte fields keep the vertex data aligned.
+//
+typedef struct yo__mesh_header {
+    unsigned int magic;      // yo__meshmagic
+    unsigned int version;    // yo__meshversion
+    long long source_size;   // size of the source file, -1 if none
+    long long source_time;   // modification time of the source file (ns)
+    long long nverts;        // number of vertices
+    long long size;          // bytes of vertex data
+    long long ntriangles;    // number of triangles
+    long long index_size;    // bytes per index
+} yo__mesh_header;
+
+// size and modification time of a file, the time in the finest resolution
+// the platform has (100 ns on Windows, ns with POSIX.1-2008)
+static inline bool
+yo__file_stamp(const char* filename, long long* size, long long* time) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &data))
+        return false;
+    *size = (long long)data.nFileSizeHigh << 32 | data.nFileSizeLow;
+    *time = (long long)data.ftLastWriteTime.dwHighDateTime << 32 |
+            data.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat st;
+    if (stat(filename, &st)) return false;
+    *size = (long long)st.st_size;
+#if defined(__APPLE__)
+    *time = (long long)st.st_mtimespec.tv_sec * 1000000000 +
+            st.st_mtimespec.tv_nsec;
+#elif defined(st_mtime)  // st_mtim with POSIX.1-2008
+    *time = (long long)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#else
+    *time = (long long)st.st_mtime;
+#endif
+#endif
+    return true;
+}
+
+// index size for a number of vertices
+static inline int
+yo__mesh_index_size(int nverts) {
+    return (nverts <= 65536) ? 2 : 4;
+}
+
+// bytes of the indices
+static inline size_t
+yo__mesh_index_bytes(const yo_mesh* mesh) {
+    return (size_t)mesh->ntriangles * 3 * mesh->index_size;
+}
+
+//
+// Index of a mesh
+//
+YO_API int
+yo_mesh_index(const yo_mesh* mesh, int i) {
+    return (mesh->index_size == 2) ? ((unsigned short*)mesh->indices)[i]
+                                   : ((int*)mesh->indices)[i];
+}
+
+//
+// Merges the triangle shapes
+//
+YO_API yo_mesh*
+yo_make_mesh(const yo_scene* scene) {
+    yo_mesh* mesh = yo__new(yo_mesh);
+    for (int i = 0; i < scene->nshapes; i++) {
+        if (scene->shapes[i].etype != yo_etype_triangle) continue;
+        mesh->nverts += scene->shapes[i].nverts;
+        mesh->ntriangles += scene->shapes[i].nelems;
+    }
+    mesh->size = sizeof(float) * 6 * (size_t)mesh->nverts;
+    mesh->index_size = yo__mesh_index_size(mesh->nverts);
+    size_t index_bytes = yo__mesh_index_bytes(mesh);
+    mesh->pos = (float*)calloc(mesh->size + index_bytes + 1, 1);
+    mesh->norm = mesh->pos + 3 * (size_t)mesh->nverts;
+    mesh->indices = (char*)mesh->pos + mesh->size;
+
+    // vertices and indices shape by shape, offset by the previous vertices
+    int vertex = 0;
+    size_t n = 0;
+    for (int i = 0; i < scene->nshapes; i++) {
+        const yo_shape* shape = scene->shapes + i;
+        if (shape->etype != yo_etype_triangle) continue;
+        memcpy(mesh->pos + 3 * (size_t)vertex, shape->pos,
+               sizeof(float) * 3 * shape->nverts);
+        if (shape->norm)
+            memcpy(mesh->norm + 3 * (size_t)vertex, shape->norm,
+                   sizeof(float) * 3 * shape->nverts);
+        for (int j = 0; j < shape->nelems * 3; j++, n++) {
+            int vid = vertex + shape->elem[j];
+            if (mesh->index_size == 2)
+                ((unsigned short*)mesh->indices)[n] = (unsigned short)vid;
+            else
+                ((int*)mesh->indices)[n] = vid;
+        }
+        vertex += shape->nverts;
+    }
+    return mesh;
+}
+
+//
+// Simulate a FIFO vertex cache
+//
+YO_API int
+yo_mesh_transforms(const yo_mesh* mesh, int cache_size) {
+    int nindices = mesh->ntriangles * 3;
+    if (cache_size <= 0) return nindices;
+
+    // a vertex is cached if less than cache_size vertices were transformed
+    // since its own transform
+    int* stamp = (int*)malloc(sizeof(int) * (mesh->nverts ? mesh->nverts : 1));
+    for (int i = 0; i < mesh->nverts; i++) stamp[i] = -cache_size - 1;
+    int transforms = 0;
+    for (int i = 0; i < nindices; i++) {
+        int vid = yo_mesh_index(mesh, i);
+        if (transforms - stamp[vid] > cache_size) stamp[vid] = transforms++;
+    }
+    free(stamp);
+    return transforms;
+}
+
+//
+// Save a mesh cache
+//
+YO_API bool
+yo_save_mesh(const char* filename, const yo_mesh* mesh, const char* source) {
+    yo__mesh_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = yo__meshmagic;
+    header.version = yo__meshversion;
+    header.source_size = -1;
+    if (source &&
+        !yo__file_stamp(source, &header.source_size, &header.source_time))
+        return false;
+    header.nverts = mesh->nverts;
+    header.size = (long long)mesh->size;
+    header.ntriangles = mesh->ntriangles;
+    header.index_size = mesh->index_size;
+
+    FILE* file = fopen(filename, "wb");
+    if (!file) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              (!mesh->size || fwrite(mesh->pos, mesh->size, 1, file) == 1) &&
+              (!mesh->ntriangles || fwrite(mesh->indices,
+                                           yo__mesh_index_bytes(mesh), 1,
+                                           file) == 1);
+    if (fclose(file)) ok = false;
+    if (!ok) remove(filename);
+    return ok;
+}
+
+//
+// Map a mesh cache
+//
+YO_API yo_mesh*
+yo_load_mesh(const char* filename, const char* source) {
+    yo__mapped_file* file = yo__new(yo__mapped_file);
+    if (!yo__map_file(filename, file)) {
+        free(file);
+        return 0;
+    }
+
+    // check the header, the size and the source
+    yo__mesh_header header;
+    bool ok = file->size >= sizeof(header);
+    if (ok) {
+        memcpy(&header, file->data, sizeof(header));
+        ok = header.magic == yo__meshmagic &&
+             header.version == yo__meshversion && header.nverts >= 0 &&
+             header.nverts < (1 << 30) && header.ntriangles >= 0 &&
+             header.ntriangles < (1 << 29) &&
+             header.index_size == yo__mesh_index_size((int)header.nverts) &&
+             header.size == header.nverts * 6 * (long long)sizeof(float) &&
+             (long long)(file->size - sizeof(header)) ==
+                 header.size + header.ntriangles * 3 * header.index_size;
+    }
+    if (ok && source) {
+        long long size, time;
+        ok = yo__file_stamp(source, &size, &time) &&
+             size == header.source_size && time == header.source_time;
+    }
+    if (!ok) {
+        yo__unmap_file(file);
+        free(file);
+        return 0;
+    }
+
+    yo_mesh* mesh = yo__new(yo_mesh);
+    mesh->nverts = (int)header.nverts;
+    mesh->pos = (float*)(file->data + sizeof(header));
+    mesh->norm = mesh->pos + 3 * (size_t)mesh->nverts;
+    mesh->size = (size_t)header.size;
+    mesh->ntriangles = (int)header.ntriangles;
+    mesh->index_size = (int)header.index_size;
+    mesh->indices = (char*)mesh->pos + mesh->size;
+    mesh->_file = file;
+    return mesh;
+}
+
+//
+// Free a mesh
+//
+YO_API void
+yo_free_mesh(yo_mesh* mesh) {
+    if (!mesh) return;
+    if (mesh->_file) {
+        yo__unmap_file((yo__mapped_file*)mesh->_file);
+        free(mesh->_file);
+    } else {
+        free(mesh->pos);
+    }
+    free(mesh);
+}
+
+// -----------------------------------------------------------------------------
+// MESH OPTIMIZATION
+// -----------------------------------------------------------------------------
+
+#define yo__optimize_block 65536  // triangles reordered per task
+#define yo__cluster_min 256       // triangles before a cluster may end
+
+typedef struct yo__mesh_optimizer {
+    const int* indices;       // input triangles
+    int* output;              // reordered triangles
+    unsigned char* clusters;  // 1 for the first triangle of each cluster
+    int ntriangles;           // number of triangles
+    int cache_size;           // entries of the vertex cache
+    int block;                // triangles per task
+    const float* pos;         // vertex positions
+    float lo[3], scale[3];    // bounds to 10 bit grid coordinates
+    unsigned int* codes;      // Morton code per triangle
+} yo__mesh_optimizer;
+
+// 10 bits spread out to every third bit
+static inline unsigned int
+yo__morton_spread(unsigned int x) {
+    x &= 0x3ff;
+    x = (x | x << 16) & 0x30000ff;
+    x = (x | x << 8) & 0x300f00f;
+    x = (x | x << 4) & 0x30c30c3;
+    x = (x | x << 2) & 0x9249249;
+    return x;
+}
+
+// Morton codes of the triangle centroids of one block
+static inline void
+yo__morton_block(void* user, int index) {
+    yo__mesh_optimizer* opt = (yo__mesh_optimizer*)user;
+    int t1 = (index + 1) * opt->block;
+    if (t1 > opt->ntriangles) t1 = opt->ntriangles;
+    for (int t = index * opt->block; t < t1; t++) {
+        unsigned int code = 0;
+        for (int i = 0; i < 3; i++) {
+            float c = 0;
+            for (int k = 0; k < 3; k++)
+                c += opt->pos[3 * (size_t)opt->indices[3 * t + k] + i];
+            float g = (c / 3 - opt->lo[i]) * opt->scale[i];
+            unsigned int x = (g > 0) ? ((g < 1023) ? (unsigned int)g : 1023) : 0;
+            code |= yo__morton_spread(x) << i;
+        }
+        opt->codes[t] = code;
+    }
+}
+
+// triangles sorted by Morton code with three stable 10 bit radix passes
+static inline int*
+yo__morton_order(const unsigned int* codes, int ntriangles) {
+    int* order = (int*)malloc(sizeof(int) * ntriangles);
+    int* temp = (int*)malloc(sizeof(int) * ntriangles);
+    for (int t = 0; t < ntriangles; t++) order[t] = t;
+    for (int shift = 0; shift < 30; shift += 10) {
+        int count[1025] = { 0 };
+        for (int t = 0; t < ntriangles; t++)
+            count[((codes[t] >> shift) & 1023) + 1]++;
+        for (int b = 0; b < 1024; b++) count[b + 1] += count[b];
+        for (int t = 0; t < ntriangles; t++) {
+            int o = order[t];
+            temp[count[(codes[o] >> shift) & 1023]++] = o;
+        }
+        int* swap = order;
+        order = temp;
+        temp = swap;
+    }
+    free(temp);
+    return order;
+}
+
+static int
+yo__compare_u64(const void* a, const void* b) {
+    unsigned long long x = *(const unsigned long long*)a;
+    unsigned long long y = *(const unsigned long long*)b;
+    return (x > y) - (x < y);
+}
+
+//
+// Tipsify (Sander, Nehab and Barczak 2007) on one block of triangles: fans
+// around a vertex, then continues with the vertex of the last fans that will
+// still be in the cache after its own fan, or after a dead end with the most
+// recent vertex with triangles left. Dead ends past yo__cluster_min
+// triangles end a cluster for the overdraw sort.
+//
+static inline void
+yo__tipsify_block(void* user, int index) {
+    yo__mesh_optimizer* opt = (yo__mesh_optimizer*)user;
+    int t0 = index * opt->block;
+    int ntris = opt->ntriangles - t0;
+    if (ntris > opt->block) ntris = opt->block;
+    int n = ntris * 3, k = opt->cache_size;
+    const int* in = opt->indices + 3 * (size_t)t0;
+    int* out = opt->output + 3 * (size_t)t0;
+    unsigned char* clusters = opt->clusters + t0;
+
+    // block local vertex ids from sorted (vertex, corner) pairs
+    unsigned long long* keys =
+        (unsigned long long*)malloc(sizeof(unsigned long long) * n);
+    for (int i = 0; i < n; i++)
+        keys[i] = (unsigned long long)(unsigned int)in[i] << 32 | (unsigned)i;
+    qsort(keys, n, sizeof(unsigned long long), yo__compare_u64);
+    int* local = (int*)malloc(sizeof(int) * n);
+    int nverts = 0;
+    for (int i = 0; i < n; i++) {
+        if (!i || (keys[i] >> 32) != (keys[i - 1] >> 32)) nverts++;
+        local[(unsigned int)keys[i]] = nverts - 1;
+    }
+    free(keys);
+
+    // triangles of every vertex
+    int* live = (int*)calloc(nverts, sizeof(int));
+    int* offset = (int*)malloc(sizeof(int) * (nverts + 1));
+    int* fill = (int*)malloc(sizeof(int) * nverts);
+    int* adj = (int*)malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) live[local[i]]++;
+    offset[0] = 0;
+    for (int v = 0; v < nverts; v++) {
+        offset[v + 1] = offset[v] + live[v];
+        fill[v] = offset[v];
+    }
+    for (int i = 0; i < n; i++) adj[fill[local[i]]++] = i / 3;
+    free(fill);
+
+    // fan until all triangles are emitted
+    int* stamp = (int*)calloc(nverts, sizeof(int));
+    unsigned char* emitted = (unsigned char*)calloc(ntris, 1);
+    int* dead = (int*)malloc(sizeof(int) * n);
+    int* cand = (int*)malloc(sizeof(int) * n);
+    int time = k + 1, cursor = 0, ndead = 0, nout = 0, ncluster = 0;
+    bool start = true;
+    for (int f = 0; f >= 0;) {
+        int ncand = 0;
+        for (int a = offset[f]; a < offset[f + 1]; a++) {
+            int t = adj[a];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+            clusters[nout] = start;
+            ncluster = start ? 1 : ncluster + 1;
+            start = false;
+            for (int c = 0; c < 3; c++) {
+                int v = local[3 * t + c];
+                out[3 * nout + c] = in[3 * t + c];
+                dead[ndead++] = v;
+                cand[ncand++] = v;
+                live[v]--;
+                if (time - stamp[v] > k) stamp[v] = time++;
+            }
+            nout++;
+        }
+
+        // next fanning vertex
+        int best = -1, priority = -1;
+        for (int c = 0; c < ncand; c++) {
+            int v = cand[c];
+            if (live[v] <= 0) continue;
+            int p = (time - stamp[v] + 2 * live[v] <= k) ? time - stamp[v] : 0;
+            if (p > priority) {
+                priority = p;
+                best = v;
+            }
+        }
+        if (best < 0) {
+            while (ndead > 0 && best < 0) {
+                int v = dead[--ndead];
+                if (live[v] > 0) best = v;
+            }
+            while (best < 0 && cursor < nverts && !live[cursor]) cursor++;
+            if (best < 0 && cursor < nverts) best = cursor;
+            if (ncluster >= yo__cluster_min) start = true;
+        }
+        f = best;
+    }
+
+    free(local);
+    free(live);
+    free(offset);
+    free(adj);
+    free(stamp);
+    free(emitted);
+    free(dead);
+    free(cand);
+}
+
+typedef struct yo__cluster {
+    double key;  // facing away from the center
+    int first;   // first triangle
+    int count;   // number of triangles
+} yo__cluster;
+
+static int
+yo__compare_clusters(const void* a, const void* b) {
+    const yo__cluster* x = (const yo__cluster*)a;
+    const yo__cluster* y = (const yo__cluster*)b;
+    if (x->key != y->key) return (x->key < y->key) ? 1 : -1;
+    return x->first - y->first;
+}
+
+//
+// View independent overdraw order (Sander et al. 2007): clusters that face
+// away from the mesh center are likely in front of the others from any view,
+// so they are drawn first.
+//
+static inline void
+yo__sort_clusters(const yo_mesh* mesh, yo__mesh_optimizer* opt) {
+    int nclusters = 0;
+    for (int t = 0; t < opt->ntriangles; t++) nclusters += opt->clusters[t];
+    yo__cluster* clusters =
+        (yo__cluster*)calloc(nclusters ? nclusters : 1, sizeof(yo__cluster));
+    double* centers = (double*)calloc(nclusters * 3 + 1, sizeof(double));
+    double* normals = (double*)calloc(nclusters * 3 + 1, sizeof(double));
+    double center[3] = { 0, 0, 0 }, area = 0;
+
+    // area weighted cluster centers and normals
+    for (int t = 0, c = -1; t < opt->ntriangles; t++) {
+        if (opt->clusters[t]) clusters[++c].first = t;
+        clusters[c].count++;
+        const float* p[3];
+        for (int i = 0; i < 3; i++)
+            p[i] = mesh->pos + 3 * (size_t)opt->output[3 * t + i];
+        double e1[3], e2[3], nt[3];
+        for (int i = 0; i < 3; i++) {
+            e1[i] = p[1][i] - p[0][i];
+            e2[i] = p[2][i] - p[0][i];
+        }
+        nt[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        nt[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        nt[2] = e1[0] * e2[1] - e1[1] * e2[0];
+        double a = sqrt(nt[0] * nt[0] + nt[1] * nt[1] + nt[2] * nt[2]);
+        for (int i = 0; i < 3; i++) {
+            double ct = (p[0][i] + p[1][i] + p[2][i]) / 3;
+            centers[3 * c + i] += a * ct;
+            normals[3 * c + i] += nt[i];
+            center[i] += a * ct;
+        }
+        clusters[c].key += a;  // area for now
+        area += a;
+    }
+    for (int i = 0; i < 3; i++) center[i] /= (area > 0) ? area : 1;
+    for (int c = 0; c < nclusters; c++) {
+        double a = clusters[c].key, key = 0, len = 0;
+        for (int i = 0; i < 3; i++) {
+            double d = (a > 0) ? centers[3 * c + i] / a - center[i] : 0;
+            key += d * normals[3 * c + i];
+            len += normals[3 * c + i] * normals[3 * c + i];
+        }
+        clusters[c].key = (len > 0) ? key / sqrt(len) : 0;
+    }
+    qsort(clusters, nclusters, sizeof(yo__cluster), yo__compare_clusters);
+
+    // clusters in the new order
+    int* sorted = (int*)malloc(sizeof(int) * 3 * (size_t)opt->ntriangles);
+    size_t n = 0;
+    for (int c = 0; c < nclusters; c++) {
+        size_t count = 3 * (size_t)clusters[c].count;
+        memcpy(sorted + n, opt->output + 3 * (size_t)clusters[c].first,
+               sizeof(int) * count);
+        n += count;
+    }
+    memcpy(opt->output, sorted, sizeof(int) * n);
+    free(sorted);
+    free(clusters);
+    free(centers);
+    free(normals);
+}
+
+//
+// Optimize a mesh
+//
+YO_API void
+yo_optimize_mesh(yo_mesh* mesh, int cache_size, bool overdraw,
+                 yo_parallel_for parallel_for) {
+    if (mesh->_file || !mesh->ntriangles) return;
+
+    yo__mesh_optimizer opt;
+    memset(&opt, 0, sizeof(opt));
+    int nindices = mesh->ntriangles * 3;
+    int* indices = (int*)malloc(sizeof(int) * nindices);
+    for (int i = 0; i < nindices; i++) indices[i] = yo_mesh_index(mesh, i);
+    opt.indices = indices;
+    opt.ntriangles = mesh->ntriangles;
+    opt.cache_size = (cache_size > 0) ? cache_size : 1;
+    opt.block = yo__optimize_block;
+    int nblocks = (mesh->ntriangles + opt.block - 1) / opt.block;
+
+    // triangles in Morton order of their centroids, so that every block is a
+    // compact patch of the surface whatever the order of the file
+    opt.pos = mesh->pos;
+    for (int i = 0; i < 3; i++) {
+        float lo = mesh->pos[i], hi = mesh->pos[i];
+        for (int v = 1; v < mesh->nverts; v++) {
+            float p = mesh->pos[3 * (size_t)v + i];
+            lo = (p < lo) ? p : lo;
+            hi = (p > hi) ? p : hi;
+        }
+        opt.lo[i] = lo;
+        opt.scale[i] = (hi > lo) ? 1024 / (hi - lo) : 0;
+    }
+    opt.codes = (unsigned int*)malloc(sizeof(unsigned int) * opt.ntriangles);
+    yo__run_tasks(parallel_for, nblocks, yo__morton_block, &opt);
+    int* order = yo__morton_order(opt.codes, opt.ntriangles);
+    int* sorted = (int*)malloc(sizeof(int) * nindices);
+    for (int t = 0; t < opt.ntriangles; t++)
+        memcpy(sorted + 3 * t, indices + 3 * order[t], sizeof(int) * 3);
+    free(order);
+    free(opt.codes);
+    free(indices);
+    indices = sorted;
+    opt.indices = indices;
+
+    // triangle order
+    opt.output = (int*)malloc(sizeof(int) * nindices);
+    opt.clusters = (unsigned char*)malloc(mesh->ntriangles);
+    yo__run_tasks(parallel_for, nblocks, yo__tipsify_block, &opt);
+    if (overdraw) yo__sort_clusters(mesh, &opt);
+
+    // vertex order of first use, unused ones last
+    int* remap = (int*)malloc(sizeof(int) * (mesh->nverts ? mesh->nverts : 1));
+    for (int v = 0; v < mesh->nverts; v++) remap[v] = -1;
+    int next = 0;
+    for (int i = 0; i < nindices; i++)
+        if (remap[opt.output[i]] < 0) remap[opt.output[i]] = next++;
+    for (int v = 0; v < mesh->nverts; v++)
+        if (remap[v] < 0) remap[v] = next++;
+
+    // new buffers
+    float* pos = (float*)malloc(mesh->size + yo__mesh_index_bytes(mesh) + 1);
+    float* norm = pos + 3 * (size_t)mesh->nverts;
+    void* elem = (char*)pos + mesh->size;
+    for (int v = 0; v < mesh->nverts; v++) {
+        memcpy(pos + 3 * (size_t)remap[v], mesh->pos + 3 * (size_t)v,
+               sizeof(float) * 3);
+        memcpy(norm + 3 * (size_t)remap[v], mesh->norm + 3 * (size_t)v,
+               sizeof(float) * 3);
+    }
+    for (int i = 0; i < nindices; i++) {
+        int vid = remap[opt.output[i]];
+        if (mesh->index_size == 2)
+            ((unsigned short*)elem)[i] = (unsigned short)vid;
+        else
+            ((int*)elem)[i] = vid;
+    }
+    free(mesh->pos);
+    mesh->pos = pos;
+    mesh->norm = norm;
+    mesh->indices = elem;
+
+    free(remap);
+    free(indices);
+    free(opt.output);
+    free(opt.clusters);
+}
+
 // -----------------------------------------------------------------------------
 // TEXTURE HANDLING
 // -----------------------------------------------------------------------------